@@ -30,6 +30,16 @@ for %%a in (%*) do (
     	set OUTPUT_NAME=%EXE_NAME%_perf.exe
     	set FIRST_SRC=perf_main.cpp
     ) 
+    
+    if "%%a"=="--pipeline" (
+    	set OUTPUT_NAME=%EXE_NAME%_pipeline.exe
+    	set FIRST_SRC=pipeline_main.cpp
+    ) 
+    
+    if "%%a"=="--compiler" (
+    	set OUTPUT_NAME=%EXE_NAME%_compiler.exe
+    	set FIRST_SRC=compiler_main.cpp
+    ) 
 )
 
 REM Create the build directory if it doesn't exist
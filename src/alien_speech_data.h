@@ -1,57 +1,240 @@
 #ifndef _ALIEN_SPEECH_DATA_H_
 #define _ALIEN_SPEECH_DATA_H_
 
+#include "simple_tokenizer.h"
+#include "arpabet.h"
+
 struct SymbolPair {
     const char* key;
     const char* value; 
 };
 
-SymbolPair vowel_map[] = {
+constexpr SymbolPair vowel_map[] = {
     #define VOWEL(symbol, alien_vowel) { #symbol, #alien_vowel },
     #include "symbols.xmacro"
 };
 
-SymbolPair consonant_map[] = {
+constexpr SymbolPair consonant_map[] = {
     #define CONSONANT(symbol, alien_consonant) { #symbol, #alien_consonant },
     #include "symbols.xmacro"
 };
 
 enum Unit {
-    #define ALIEN_SPEECH_UNIT(symbol) Unit_##symbol,
+    #define ALIEN_SPEECH_UNIT(symbol, file) Unit_##symbol,
     #include "symbols.xmacro"
     Unit_Count
 };
 
-const char* UnitStrings[] = {
-    #define ALIEN_SPEECH_UNIT(symbol) #symbol,
+constexpr const char* UnitStrings[] = {
+    #define ALIEN_SPEECH_UNIT(symbol, file) #symbol,
     #include "symbols.xmacro"
 };
 
 const char* UnitAssetPaths[] {
-    #define ALIEN_SPEECH_UNIT(symbol) "data/audio/" #symbol ".mp3",
+    #define ALIEN_SPEECH_UNIT(symbol, file) "data/audio/" #file ".mp3",
     #include "symbols.xmacro"
 };
 
-bool IsVowel(ParsedToken token, int* index) {
-    if (token.length == 2) {
-        for (int i = 0; i < countOf(vowel_map); i++) {
-            if (vowel_map[i].key[0] == token.text[0] && vowel_map[i].key[1] == token.text[1]) {
-                *index = i;
-                return true;
-            }  
+#define UNIT_NONE 0xFF
+
+static_assert(Unit_Count < UNIT_NONE, "Unit ids must fit in a u8.");
+
+// Everything the translation needs, generated from symbols.xmacro at compile time so classifying
+// or mapping a phone is one array load.
+struct AlienSpeechTables {
+    // By PhoneCode: index into vowel_map/consonant_map, or -1.
+    s8 vowel_index[PHONE_CODE_COUNT];
+    s8 consonant_index[PHONE_CODE_COUNT];
+    
+    // By Phone id: the alien letter - 'A', or -1.
+    s8 alien_vowel[Phone_Count];
+    s8 alien_consonant[Phone_Count];
+    
+    // [alien_consonant - 'A'][alien_vowel - 'A'] -> Unit, or UNIT_NONE.
+    u8 units[26][26];
+};
+
+constexpr AlienSpeechTables BuildAlienSpeechTables() {
+    AlienSpeechTables tables = {};
+    for (int i = 0; i < PHONE_CODE_COUNT; i++) {
+        tables.vowel_index[i] = -1;
+        tables.consonant_index[i] = -1;
+    }
+    for (int i = 0; i < (int)countOf(vowel_map); i++) {
+        tables.vowel_index[PhoneCode(vowel_map[i].key)] = (s8)i;
+    }
+    for (int i = 0; i < (int)countOf(consonant_map); i++) {
+        tables.consonant_index[PhoneCode(consonant_map[i].key)] = (s8)i;
+    }
+    
+    for (int i = 0; i < Phone_Count; i++) {
+        tables.alien_vowel[i] = -1;
+        tables.alien_consonant[i] = -1;
+        
+        int code = PhoneCode(PhoneStrings[i]);
+        if (code < 0) {
+            continue;
+        }
+        if (tables.vowel_index[code] >= 0) {
+            tables.alien_vowel[i] = (s8)(vowel_map[tables.vowel_index[code]].value[0] - 'A');
+        }
+        if (tables.consonant_index[code] >= 0) {
+            tables.alien_consonant[i] = (s8)(consonant_map[tables.consonant_index[code]].value[0] - 'A');
+        }
+    }
+    
+    for (int c = 0; c < 26; c++) {
+        for (int v = 0; v < 26; v++) {
+            tables.units[c][v] = UNIT_NONE;
+        }
+    }
+    for (int i = 0; i < Unit_Count; i++) {
+        tables.units[UnitStrings[i][0] - 'A'][UnitStrings[i][1] - 'A'] = (u8)i;
+    }
+    
+    return tables;
+}
+
+// Symbols must be ARPAbet phones, listed once, and either a vowel or a consonant. Units must be
+// two upper case letters and unique.
+constexpr bool AlienSpeechSymbolsAreValid() {
+    for (int i = 0; i < (int)countOf(vowel_map); i++) {
+        int code = PhoneCode(vowel_map[i].key);
+        if (code < 0 || phone_code_table.phones[code] == Phone_None) {
+            return false;
+        }
+        for (int j = 0; j < i; j++) {
+            if (PhoneCode(vowel_map[j].key) == code) {
+                return false;
+            }
+        }
+    }
+    for (int i = 0; i < (int)countOf(consonant_map); i++) {
+        int code = PhoneCode(consonant_map[i].key);
+        if (code < 0 || phone_code_table.phones[code] == Phone_None) {
+            return false;
+        }
+        for (int j = 0; j < i; j++) {
+            if (PhoneCode(consonant_map[j].key) == code) {
+                return false;
+            }
+        }
+        for (int j = 0; j < (int)countOf(vowel_map); j++) {
+            if (PhoneCode(vowel_map[j].key) == code) {
+                return false;
+            }
+        }
+    }
+    for (int i = 0; i < Unit_Count; i++) {
+        const char* unit = UnitStrings[i];
+        if (unit[0] < 'A' || unit[0] > 'Z' || unit[1] < 'A' || unit[1] > 'Z' || unit[2] != 0) {
+            return false;
+        }
+        for (int j = 0; j < i; j++) {
+            if (UnitStrings[j][0] == unit[0] && UnitStrings[j][1] == unit[1]) {
+                return false;
+            }
         }
     }
+    return true;
+}
+
+static_assert(AlienSpeechSymbolsAreValid(), "symbols.xmacro has an unknown, duplicate or malformed symbol.");
+
+constexpr AlienSpeechTables alien_speech_tables = BuildAlienSpeechTables();
+
+// Fingerprint of everything a compiled dictionary image bakes in: the Phone ids its packed phones
+// use, the Unit ids and the tables PhonesToUnits maps with. Editing symbols.xmacro changes it, so
+// an image compiled for other symbols is rejected (see cmu_dictionary_image.h). Bump
+// ALIEN_SPEECH_MAPPING_VERSION when PhonesToUnits itself maps differently.
+#define ALIEN_SPEECH_MAPPING_VERSION 1
+
+constexpr u32 FingerprintString(u32 hash, const char* str) {
+    size_t length = 0;
+    while (str[length] != '\0') ++length;
+    return FNV1a_32(str, length + 1, hash); // With the terminator, so "A","BC" != "AB","C".
+}
+
+constexpr u32 BuildAlienSpeechFingerprint() {
+    u32 hash = FNV32_OFFSET;
+    hash = (hash ^ ALIEN_SPEECH_MAPPING_VERSION) * FNV32_PRIME;
+    for (int i = 0; i < Phone_Count; i++) {
+        hash = FingerprintString(hash, PhoneStrings[i]);
+    }
+    for (int i = 0; i < Unit_Count; i++) {
+        hash = FingerprintString(hash, UnitStrings[i]);
+    }
+    for (int i = 0; i < Phone_Count; i++) {
+        hash = (hash ^ (u8)alien_speech_tables.alien_vowel[i]) * FNV32_PRIME;
+        hash = (hash ^ (u8)alien_speech_tables.alien_consonant[i]) * FNV32_PRIME;
+    }
+    for (int c = 0; c < 26; c++) {
+        for (int v = 0; v < 26; v++) {
+            hash = (hash ^ alien_speech_tables.units[c][v]) * FNV32_PRIME;
+        }
+    }
+    return hash;
+}
+
+constexpr u32 alien_speech_fingerprint = BuildAlienSpeechFingerprint();
+
+inline int TokenPhoneCode(ParsedToken token) {
+    if (token.length == 1) {
+        return PhoneCode(token.text[0], 0);
+    } else if (token.length == 2) {
+        return PhoneCode(token.text[0], token.text[1]);
+    }
+    return -1;
+}
+
+bool IsVowel(ParsedToken token, int* index) {
+    int code = TokenPhoneCode(token);
+    if (code >= 0 && alien_speech_tables.vowel_index[code] >= 0) {
+        *index = alien_speech_tables.vowel_index[code];
+        return true;
+    }
     return false;
 }
 
 bool IsConsonant(ParsedToken token, int* index) {
-    for (int i = 0; i < countOf(consonant_map); i++) {
-        if (StringEquals(consonant_map[i].key, CStringLength(consonant_map[i].key), token.text, token.length)) {
-            *index = i;
-            return true;
-        }
+    int code = TokenPhoneCode(token);
+    if (code >= 0 && alien_speech_tables.consonant_index[code] >= 0) {
+        *index = alien_speech_tables.consonant_index[code];
+        return true;
     }
     return false;
 }
 
+// Translates a pronunciation into units. Every vowel becomes one unit made of the alien form of the
+// last consonant before it (X at the start of the word) and the alien vowel. Pairs without a unit
+// are dropped. Matches the PhoneUnitMapper signature so the dictionary can precompile every word
+// with it.
+int PhonesToUnits(const u8* phones, int phone_count, u8* units) {
+    int unit_count = 0;
+    s8 onset_consonant = 'X' - 'A';
+    
+    for (int p = 0; p < phone_count; p++) {
+        u8 phone = PhoneId(phones[p]);
+        
+        s8 vowel = alien_speech_tables.alien_vowel[phone];
+        if (vowel >= 0) {
+            u8 unit = alien_speech_tables.units[onset_consonant][vowel];
+            if (unit != UNIT_NONE) {
+                units[unit_count++] = unit;
+            }
+            
+            #ifdef _DEBUG
+                if (unit == UNIT_NONE) {
+                    fprintf(stderr, "NOT FOUND: %c%c\n", 'A' + onset_consonant, 'A' + vowel);
+                }
+            #endif
+            
+        } else if (alien_speech_tables.alien_consonant[phone] >= 0) {
+            onset_consonant = alien_speech_tables.alien_consonant[phone];
+        }
+    }
+    
+    return unit_count;
+}
+
 #endif //_ALIEN_SPEECH_DATA_H_
\ No newline at end of file
@@ -0,0 +1,191 @@
+#ifndef _ALIEN_TRANSLATOR_H_
+#define _ALIEN_TRANSLATOR_H_
+
+#include "cmu_dictionary.h"
+#include "profiler_timer.h"
+
+// Text to unit id translation, usable outside of main().
+//
+// The dictionary is only read, so any number of threads can translate with it at once as long as
+// every thread has its own TranslationContext. Scratch memory grows through the context allocator
+// the first time a longer word shows up and is reused after that, so translating in a loop doesn't
+// allocate once it has warmed up. Errors are returned, never asserted.
+
+struct TranslatedWord {
+    const char* text;   // Lower case word, only valid during the sink call (not null terminated).
+    int length;
+    int entry;          // Dictionary entry index, or -1 if the word isn't in the dictionary.
+    const u8* units;    // Points into the dictionary; unit_count is 0 for unknown words.
+    int unit_count;
+};
+
+// Receives every word in order. Returning false stops the translation (TranslateText returns false).
+typedef bool (*UnitSinkProc)(void* data, TranslatedWord* word);
+
+struct UnitSink {
+    UnitSinkProc proc;
+    void* data;
+};
+
+struct TranslationContext {
+    CMU_Dictionary* dict;
+    Allocator allocator;
+
+    // Lower case copy of the current word.
+    char* word;
+    int word_capacity;
+
+    // Counters for the last TranslateText call.
+    int word_count;
+    int missing_word_count;
+};
+
+// The dictionary must have units (an image from the compiler or PrecompileDictionaryUnits).
+bool InitTranslationContext(TranslationContext* ctx, CMU_Dictionary* dict, Allocator allocator) {
+    *ctx = {};
+    if (!dict->has_units) {
+        return false;
+    }
+
+    ctx->dict = dict;
+    ctx->allocator = allocator;
+    return true;
+}
+
+void FreeTranslationContext(TranslationContext* ctx) {
+    if (ctx->allocator.free) {
+        ctx->allocator.free(ctx->allocator.context, ctx->word);
+    }
+    *ctx = {};
+}
+
+internal bool ReserveWord(TranslationContext* ctx, int length) {
+    if (length <= ctx->word_capacity) {
+        return true;
+    }
+
+    int capacity = ctx->word_capacity ? ctx->word_capacity : 64;
+    while (capacity < length) {
+        capacity *= 2;
+    }
+
+    char* word = (char*)ctx->allocator.realloc(ctx->allocator.context, ctx->word, capacity);
+    if (word == 0) {
+        return false;
+    }
+    ctx->word = word;
+    ctx->word_capacity = capacity;
+    return true;
+}
+
+// Splits text[0, length) on whitespace, looks every word up (case-insensitive) and passes the
+// result to sink. text doesn't need to be null terminated. Returns false if scratch memory could
+// not grow or the sink stopped the translation.
+bool TranslateText(TranslationContext* ctx, const char* text, int length, UnitSink sink) {
+    PROFILE_ZONE("translate");
+    ctx->word_count = 0;
+    ctx->missing_word_count = 0;
+
+    int at = 0;
+    while (at < length) {
+        int word_length = 0;
+        {
+            PROFILE_ZONE("tokenize");
+            while (at < length && IsWhitespace(text[at])) {
+                at++;
+            }
+
+            int start = at;
+            while (at < length && !IsWhitespace(text[at])) {
+                at++;
+            }
+
+            word_length = at - start;
+            if (word_length == 0) {
+                break;
+            }
+
+            if (!ReserveWord(ctx, word_length)) {
+                return false;
+            }
+            memcpy(ctx->word, text + start, word_length);
+            ToLowerCase(ctx->word, word_length);
+        }
+
+        TranslatedWord word = {};
+        word.text = ctx->word;
+        word.length = word_length;
+        {
+            PROFILE_ZONE("lookup");
+            word.entry = FindEntry(ctx->dict, ctx->word, word_length);
+        }
+        if (word.entry >= 0) {
+            CMU_Entry* entry = &ctx->dict->entries[word.entry];
+            word.units = EntryUnits(ctx->dict, entry);
+            word.unit_count = entry->unit_count;
+        } else {
+            ctx->missing_word_count++;
+        }
+        ctx->word_count++;
+
+        if (!sink.proc(sink.data, &word)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Growable unit id buffer, the usual sink. Set count to 0 to reuse it for the next text.
+struct UnitBuffer {
+    u8* units;
+    int count;
+    int capacity;
+    Allocator allocator;
+};
+
+bool AppendUnits(UnitBuffer* buffer, const u8* units, int count) {
+    PROFILE_ZONE("unit selection");
+    if (count == 0) {
+        return true;
+    }
+    if (buffer->count + count > buffer->capacity) {
+        int capacity = buffer->capacity ? buffer->capacity : 256;
+        while (capacity < buffer->count + count) {
+            capacity *= 2;
+        }
+
+        u8* grown = (u8*)buffer->allocator.realloc(buffer->allocator.context, buffer->units, capacity);
+        if (grown == 0) {
+            return false;
+        }
+        buffer->units = grown;
+        buffer->capacity = capacity;
+    }
+
+    memcpy(buffer->units + buffer->count, units, count);
+    buffer->count += count;
+    return true;
+}
+
+void FreeUnitBuffer(UnitBuffer* buffer) {
+    if (buffer->allocator.free) {
+        buffer->allocator.free(buffer->allocator.context, buffer->units);
+    }
+    buffer->units = 0;
+    buffer->count = 0;
+    buffer->capacity = 0;
+}
+
+internal bool UnitBufferSinkProc(void* data, TranslatedWord* word) {
+    return AppendUnits((UnitBuffer*)data, word->units, word->unit_count);
+}
+
+inline UnitSink UnitBufferSink(UnitBuffer* buffer) {
+    UnitSink sink = {};
+    sink.proc = UnitBufferSinkProc;
+    sink.data = buffer;
+    return sink;
+}
+
+#endif // _ALIEN_TRANSLATOR_H_
@@ -0,0 +1,152 @@
+#ifndef _ARPABET_H_
+#define _ARPABET_H_
+
+#include "utility.h"
+
+// ARPAbet phones as small integer ids (see ARPABET_PHONE in symbols.xmacro).
+//
+// A pronunciation is stored as one byte per phone: the id in the low 6 bits and the stress in the
+// top 2 bits (0 = no stress digit, otherwise the digit + 1). "AA1 L B" is { AA|stress 1, L, B }.
+
+enum Phone {
+    Phone_None = 0,
+    #define ARPABET_PHONE(symbol) Phone_##symbol,
+    #include "symbols.xmacro"
+    Phone_Count
+};
+
+constexpr const char* PhoneStrings[] = {
+    "",
+    #define ARPABET_PHONE(symbol) #symbol,
+    #include "symbols.xmacro"
+};
+
+#define PHONE_ID_MASK      0x3F
+#define PHONE_STRESS_SHIFT 6
+#define PHONE_NO_STRESS    -1
+
+static_assert(Phone_Count <= PHONE_ID_MASK + 1, "Phone ids must fit in 6 bits.");
+
+inline u8 PackPhone(u8 id, int stress) {
+    u8 stress_bits = (stress >= 0 && stress <= 2) ? (u8)(stress + 1) : 0;
+    return (u8)(id | (stress_bits << PHONE_STRESS_SHIFT));
+}
+
+inline u8 PhoneId(u8 packed) {
+    return packed & PHONE_ID_MASK;
+}
+
+// Returns the stress digit (0, 1 or 2) or PHONE_NO_STRESS.
+inline int PhoneStress(u8 packed) {
+    return (int)(packed >> PHONE_STRESS_SHIFT) - 1;
+}
+
+// One or two upper case letters packed into a small dense index (26 first letters times 27 second
+// letters, counting "none"), so tables keyed by symbol are plain arrays. -1 for anything else.
+#define PHONE_CODE_COUNT (26 * 27)
+
+constexpr int PhoneCode(char c0, char c1) {
+    bool valid = c0 >= 'A' && c0 <= 'Z' && (c1 == 0 || (c1 >= 'A' && c1 <= 'Z'));
+    return valid ? (c0 - 'A') * 27 + (c1 ? c1 - 'A' + 1 : 0) : -1;
+}
+
+// Works on the xmacro strings: "B" packs as ('B', 0).
+constexpr int PhoneCode(const char* symbol) {
+    return symbol[0] ? PhoneCode(symbol[0], symbol[1]) : -1;
+}
+
+struct PhoneCodeTable {
+    u8 phones[PHONE_CODE_COUNT];
+};
+
+constexpr PhoneCodeTable BuildPhoneCodeTable() {
+    PhoneCodeTable table = {};
+    for (int i = 1; i < Phone_Count; i++) {
+        table.phones[PhoneCode(PhoneStrings[i])] = (u8)i;
+    }
+    return table;
+}
+
+constexpr PhoneCodeTable phone_code_table = BuildPhoneCodeTable();
+
+// Returns Phone_None for symbols that aren't ARPAbet.
+inline u8 PhoneFromSymbol(const char* symbol, int length) {
+    if (length < 1 || length > 2) {
+        return Phone_None;
+    }
+
+    int code = PhoneCode(symbol[0], length == 2 ? symbol[1] : 0);
+    return code >= 0 ? phone_code_table.phones[code] : (u8)Phone_None;
+}
+
+// Encodes a cmudict pronunciation ("AA1 L B AO0 R G # comment") into packed phones. Anything
+// after '#' is a comment and symbols that aren't ARPAbet are skipped. Returns the phone count.
+int EncodePhones(const char* text, int length, u8* out, int capacity) {
+    int count = 0;
+    int at = 0;
+    while (at < length && count < capacity) {
+        char c = text[at];
+        if (c == '#') {
+            break;
+        }
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            at++;
+            continue;
+        }
+
+        int start = at;
+        while (at < length && text[at] >= 'A' && text[at] <= 'Z') {
+            at++;
+        }
+        int symbol_length = at - start;
+
+        int stress = PHONE_NO_STRESS;
+        if (at < length && text[at] >= '0' && text[at] <= '9') {
+            stress = text[at] - '0';
+            at++;
+        }
+
+        // Skip the rest of a malformed token.
+        while (at < length && text[at] != ' ' && text[at] != '\t' && text[at] != '\n') {
+            at++;
+            symbol_length = 0;
+        }
+
+        u8 id = PhoneFromSymbol(text + start, symbol_length);
+        if (id != Phone_None) {
+            out[count++] = PackPhone(id, stress);
+        }
+    }
+    return count;
+}
+
+// Writes packed phones back as cmudict text ("AA1 L B"), null terminated and without comments.
+// 4 bytes per phone is always enough. Returns the text length.
+int FormatPhones(const u8* phones, int count, char* out, int capacity) {
+    int length = 0;
+    for (int i = 0; i < count; i++) {
+        const char* symbol = PhoneStrings[PhoneId(phones[i])];
+        int stress = PhoneStress(phones[i]);
+        int symbol_length = symbol[0] ? (symbol[1] ? 2 : 1) : 0;
+        int needed = (i > 0) + symbol_length + (stress != PHONE_NO_STRESS);
+        if (length + needed + 1 > capacity) {
+            break;
+        }
+
+        if (i > 0) {
+            out[length++] = ' ';
+        }
+        while (*symbol) {
+            out[length++] = *symbol++;
+        }
+        if (stress != PHONE_NO_STRESS) {
+            out[length++] = (char)('0' + stress);
+        }
+    }
+    if (capacity > 0) {
+        out[length] = 0;
+    }
+    return length;
+}
+
+#endif // _ARPABET_H_
@@ -0,0 +1,210 @@
+#ifndef _BATCH_TRANSLATOR_H_
+#define _BATCH_TRANSLATOR_H_
+
+#include "alien_translator.h"
+#include "unit_clip_loader.h"
+#include "render_stream.h"
+#include "profiler_timer.h"
+#include "memory_arena.h"
+#include "text_lines.h"
+
+// Renders a file of dialogue lines to one WAV per line.
+//
+// The dictionary and the unit clips are shared read-only by every worker. Each worker owns a
+// scratch arena: the file write buffer sits at its bottom, and everything a line needs on top of
+// that (translation context, unit ids, render plan) is released with one reset, so a warmed-up
+// worker doesn't call malloc at all. Workers claim lines a few at a time from a shared cursor:
+// the list is known up front and lines are independent, so whoever finishes early simply takes
+// the next claim, which balances uneven lines the same way work stealing would without per-worker
+// deques.
+//
+// Output files are named after the input line number (out_directory/000042.wav); blank lines are
+// skipped.
+
+#define BATCH_MAX_WORKERS       MAX_PARALLEL_THREADS
+#define BATCH_LINES_PER_CLAIM   4
+#define BATCH_WRITE_BUFFER_SIZE (256 * 1024)
+#define BATCH_SCRATCH_SIZE      (64 * 1024 * 1024)
+
+struct BatchSettings {
+    const char* out_directory;
+    WavSampleFormat format;
+    u32 xfade_frames;
+    const TransitionCache* transitions; // Optional, needs every clip decoded.
+};
+
+struct BatchJob {
+    CMU_Dictionary* dict;
+    UnitClipSet* clips;
+    BatchSettings settings;
+
+    TextLine* lines;
+    s32 line_count;
+    volatile s32 next_line;
+};
+
+struct BatchWorker {
+    BatchJob* job;
+
+    Arena scratch;
+    ArenaMark line_mark;    // Everything above this belongs to the current line.
+    u8* write_buffer;
+    char path[1024];
+
+    u64 lines_done;
+    u64 lines_failed;
+    u64 words;
+    u64 missing_words;
+    u64 frames;
+};
+
+struct BatchStats {
+    u32 workers;
+    u64 lines_done;
+    u64 lines_failed;
+    u64 words;
+    u64 missing_words;
+    u64 frames;
+    double ms;
+};
+
+// Everything allocated here comes from the worker's scratch and is dropped by the caller.
+internal bool RenderBatchLine(BatchWorker* worker, TextLine* line) {
+    PROFILE_ZONE("batch line");
+    BatchJob* job = worker->job;
+    UnitClipSet* clips = job->clips;
+    Allocator scratch = ArenaAllocator(&worker->scratch);
+
+    TranslationContext translator;
+    InitTranslationContext(&translator, job->dict, scratch);
+    UnitBuffer units = {};
+    units.allocator = scratch;
+
+    if (!TranslateText(&translator, line->text, (int)line->length, UnitBufferSink(&units))) {
+        fprintf(stderr, "Line %u: out of memory while translating.\n", line->line_number);
+        return false;
+    }
+    worker->words += translator.word_count;
+    worker->missing_words += translator.missing_word_count;
+
+    PrepareUnitClips(clips, units.units, units.count);
+
+    RenderStream stream;
+    bool success = InitRenderStream(&stream, clips->clips, units.units, 0, units.count,
+                                    clips->channels, clips->sample_rate, job->settings.xfade_frames, scratch);
+    if (!success) {
+        fprintf(stderr, "Line %u: out of memory while planning the render.\n", line->line_number);
+    } else {
+        stream.transitions = job->settings.transitions;
+        snprintf(worker->path, sizeof(worker->path), "%s/%06u.wav", job->settings.out_directory, line->line_number);
+        success = WriteStreamToWav(&stream, worker->path, job->settings.format, worker->write_buffer, BATCH_WRITE_BUFFER_SIZE);
+        if (success) {
+            worker->frames += stream.frame_count;
+        }
+    }
+
+    FreeRenderStream(&stream, scratch);
+    return success;
+}
+
+internal void RunBatchWorker(void* data) {
+    BatchWorker* worker = (BatchWorker*)data;
+    BatchJob* job = worker->job;
+
+    for (;;) {
+        s32 first = AtomicAdd(&job->next_line, BATCH_LINES_PER_CLAIM);
+        if (first >= job->line_count) {
+            break;
+        }
+
+        s32 last = first + BATCH_LINES_PER_CLAIM < job->line_count ? first + BATCH_LINES_PER_CLAIM : job->line_count;
+        for (s32 i = first; i < last; i++) {
+            if (RenderBatchLine(worker, &job->lines[i])) {
+                worker->lines_done++;
+            } else {
+                worker->lines_failed++;
+            }
+            ResetArena(&worker->scratch, worker->line_mark);
+        }
+    }
+}
+
+// Renders every line with up to worker_count threads (the caller is one of them). The dictionary
+// must have units. Returns false only if the run could not start; per-line failures are counted.
+bool RunBatch(CMU_Dictionary* dict, UnitClipSet* clips, TextLine* lines, int line_count,
+              BatchSettings settings, u32 worker_count, BatchStats* stats) {
+    ZeroStruct(stats);
+    if (worker_count < 1) {
+        worker_count = 1;
+    }
+    if (worker_count > BATCH_MAX_WORKERS) {
+        fprintf(stderr, "Using %u workers instead of %u, the most a batch runs.\n", BATCH_MAX_WORKERS, worker_count);
+        worker_count = BATCH_MAX_WORKERS;
+    }
+
+    MyCreateDirectory(settings.out_directory);
+    if (!DirectoryExists(settings.out_directory)) {
+        fprintf(stderr, "Failed to create %s.\n", settings.out_directory);
+        return false;
+    }
+
+    BatchJob job = {};
+    job.dict = dict;
+    job.clips = clips;
+    job.settings = settings;
+    job.lines = lines;
+    job.line_count = line_count;
+
+    BatchWorker* workers = ALLOC_ARRAY(HeapAllocator, BatchWorker, worker_count);
+    if (!workers) {
+        fprintf(stderr, "Out of memory while setting up the batch workers.\n");
+        return false;
+    }
+    ZeroArray(workers, worker_count);
+    bool ready = true;
+    for (u32 i = 0; i < worker_count; i++) {
+        BatchWorker* worker = &workers[i];
+        worker->job = &job;
+        if (ReserveArena(&worker->scratch, BATCH_SCRATCH_SIZE)) {
+            worker->write_buffer = (u8*)ArenaPush(&worker->scratch, BATCH_WRITE_BUFFER_SIZE);
+            worker->line_mark = GetArenaMark(&worker->scratch);
+        }
+        ready = ready && worker->write_buffer;
+    }
+
+    Timer timer = StartTimer();
+    if (ready) {
+        RunInParallel(RunBatchWorker, workers, sizeof(BatchWorker), worker_count);
+    } else {
+        fprintf(stderr, "Failed to set up the batch workers.\n");
+    }
+    stats->ms = StopTimer(timer);
+    stats->workers = worker_count;
+
+    for (u32 i = 0; i < worker_count; i++) {
+        BatchWorker* worker = &workers[i];
+        stats->lines_done += worker->lines_done;
+        stats->lines_failed += worker->lines_failed;
+        stats->words += worker->words;
+        stats->missing_words += worker->missing_words;
+        stats->frames += worker->frames;
+
+        ReleaseArena(&worker->scratch);
+    }
+    free(workers);
+    return ready;
+}
+
+// Real-time factor is seconds of audio produced per second of wall time.
+void PrintBatchStats(BatchStats* stats, u32 sample_rate) {
+    double seconds = stats->ms / 1000.0;
+    double audio_seconds = (double)stats->frames / (double)sample_rate;
+    printf("Rendered %llu line(s) (%llu failed) with %u worker(s) in %.2f s.\n",
+           (unsigned long long)stats->lines_done, (unsigned long long)stats->lines_failed, stats->workers, seconds);
+    printf("    %.1f lines/sec, %.1f words/sec (%llu not in the dictionary)\n",
+           seconds > 0 ? stats->lines_done / seconds : 0.0, seconds > 0 ? stats->words / seconds : 0.0,
+           (unsigned long long)stats->missing_words);
+    printf("    %.1f s of audio, real-time factor %.1fx\n", audio_seconds, seconds > 0 ? audio_seconds / seconds : 0.0);
+}
+
+#endif // _BATCH_TRANSLATOR_H_
@@ -0,0 +1,19 @@
+#ifndef _BENCH_UTILITY_H_
+#define _BENCH_UTILITY_H_
+
+#include "utility.h"
+
+// Helpers shared by the benchmarks (perf_main, pipeline_main).
+
+// xorshift64. Fast and reproducible from a seed, which is all the word streams and synthetic
+// corpora need. state must not be 0.
+internal u64 NextRandom(u64* state) {
+    u64 x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+#endif // _BENCH_UTILITY_H_
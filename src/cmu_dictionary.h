@@ -4,140 +4,372 @@
 #include "assert.h"
 #include "simple_tokenizer.h"
 #include "file_io.h"
+#include "threading.h"
+#include "memory_arena.h"
+#include "profiler_timer.h"
+#include "arpabet.h"
 
-#define MAX_CMU_CLUSTERS 2048
+// Entries and look-up structures reference the dictionary by offset/index rather than by pointer
+// so the same arrays can be written to disk and memory-mapped back in (see cmu_dictionary_image.h).
 
 struct CMU_Entry {
-    ParsedToken key;
-    ParsedToken value;
-};
-
-struct CMU_Cluster {
-    // Cluster prefix: Phonemes like aa, ab, ac, etc. would be in a cluster prefixed with 'a'.  
-    char c;
+    // Offsets into CMU_Dictionary::strings.
+    u32 key_offset;
+    u32 value_offset;
     
-    // CMU_Entry Array Slice (or View)
-    CMU_Entry* first;
-    int count;
+    // Pre-encoded pronunciation: phone_count packed phones (see arpabet.h) at CMU_Dictionary::phones + phones_offset.
+    u32 phones_offset;
     
-    // Clusters can be subdvided into smaller clusters for quicker look-up.
-    // If this is 0, then its a leaf node. In that case, use the Array Slice (first, count) above. 
-    int sub_cluster_count;
-    CMU_Cluster* sub_clusters;
+    // Precompiled translation: unit_count unit ids at CMU_Dictionary::units + units_offset.
+    // Only valid when CMU_Dictionary::has_units is set.
+    u32 units_offset;
+    
+    u16 key_length;
+    u16 value_length;
+    u8 phone_count;
+    u8 unit_count;
+};
+
+// Byte-wise key order (a prefix sorts before the longer key).
+inline int CompareKeys(const char* a, int a_length, const char* b, int b_length) {
+    int length = a_length < b_length ? a_length : b_length;
+    int result = memcmp(a, b, length);
+    if (result != 0) {
+        return result;
+    }
+    return a_length - b_length;
+}
+
+// Sorts a list of entry indices by key. Stable, so duplicate keys stay in their given order.
+// scratch must hold count indices.
+void SortEntryOrder(u32* order, u32* scratch, int count, const CMU_Entry* entries, const char* strings) {
+    // Bottom-up merge sort, ping-ponging between order and scratch.
+    u32* src = order;
+    u32* dest = scratch;
+    for (int width = 1; width < count; width *= 2) {
+        for (int lo = 0; lo < count; lo += 2 * width) {
+            int mid = lo + width < count ? lo + width : count;
+            int hi = lo + 2 * width < count ? lo + 2 * width : count;
+            int a = lo;
+            int b = mid;
+            for (int i = lo; i < hi; i++) {
+                bool take_a = b >= hi;
+                if (a < mid && b < hi) {
+                    const CMU_Entry* ea = &entries[src[a]];
+                    const CMU_Entry* eb = &entries[src[b]];
+                    take_a = CompareKeys(strings + ea->key_offset, ea->key_length, strings + eb->key_offset, eb->key_length) <= 0;
+                }
+                dest[i] = (a < mid && take_a) ? src[a++] : src[b++];
+            }
+        }
+        u32* swap = src;
+        src = dest;
+        dest = swap;
+    }
+
+    if (src != order) {
+        memcpy(order, src, count * sizeof(u32));
+    }
+}
+
+// Writes the entry indices into order sorted by key, duplicate keys in file order.
+// cmudict.dict is only roughly sorted (e.g. "a(2)" comes before "a's"), so the look-up
+// structures that need a strict order sort for themselves. scratch must hold entry_count indices.
+void SortEntriesByKey(u32* order, u32* scratch, const CMU_Entry* entries, int entry_count, const char* strings) {
+    for (int i = 0; i < entry_count; i++) {
+        order[i] = (u32)i;
+    }
+    SortEntryOrder(order, scratch, entry_count, entries, strings);
+}
+
+#include "cmu_dictionary_parser.h"
+#include "cmu_radix_trie.h"
+#include "cmu_hash_index.h"
+#include "cmu_perfect_hash.h"
+#include "cmu_eytzinger.h"
+
+// Look-up structures GetPhones can use. The radix trie is always available; the others are
+// built on demand with BuildLookupIndex.
+enum CMU_LookupEngine {
+    CMU_Lookup_Trie = 0,
+    CMU_Lookup_Hash,
+    CMU_Lookup_PerfectHash,
+    CMU_Lookup_Eytzinger,
+    CMU_Lookup_Count
+};
+
+const char* CMU_LookupEngineNames[] = {
+    "trie",
+    "hash",
+    "perfect_hash",
+    "eytzinger",
 };
 
 struct CMU_Dictionary {
     int entry_count = 0;
     CMU_Entry* entries = 0;
     
-    int total_clusters;
-    CMU_Cluster root_cluster;
-    CMU_Cluster* clusters;
+    // Backing storage for keys and values. When loaded from text, this is the file buffer itself.
+    // Images leave the pronunciation text out unless compiled with it (has_text); the packed
+    // phones below hold the same information, see FormatPhones.
+    char* strings = 0;
+    u32 strings_size = 0;
+    bool has_text = true;
+    
+    // Packed phones for every entry, encoded once at load (or compile) time.
+    u8* phones = 0;
+    u32 phones_size = 0;
+    
+    // Final unit ids for every entry (see PrecompileDictionaryUnits).
+    bool has_units = false;
+    u8* units = 0;
+    u32 units_size = 0;
+    
+    CMU_RadixTrie trie = {};
+    
+    CMU_LookupEngine engine = CMU_Lookup_Trie;
+    CMU_HashIndex hash_index = {};
+    CMU_PerfectHashIndex perfect_hash_index = {};
+    CMU_EytzingerIndex eytzinger_index = {};
+    
+    // Only set when loaded with LoadDictionaryImage. The arrays above point into the mapped (read-only) pages.
+    MappedFile image;
 };
 
-CMU_Cluster* InsertCluster(CMU_Dictionary* dict, CMU_Entry* first, int text_index) {
-    assert(dict->total_clusters < MAX_CMU_CLUSTERS);
+inline char* EntryKey(CMU_Dictionary* dict, CMU_Entry* entry) {
+    return dict->strings + entry->key_offset;
+}
 
-    CMU_Cluster* cluster = &dict->clusters[dict->total_clusters];
-    cluster->c = first->key.text[text_index];
-    cluster->first = first;
-    cluster->count = 1;
-    cluster->sub_cluster_count = 0;
-    cluster->sub_clusters = 0;
-    
-    dict->total_clusters += 1;
-    return cluster;
+inline char* EntryValue(CMU_Dictionary* dict, CMU_Entry* entry) {
+    return dict->strings + entry->value_offset;
 }
 
-void BuildSubClusters(CMU_Dictionary* dict, CMU_Cluster* cluster, int text_index) {
-    CMU_Cluster* sub_cluster = InsertCluster(dict, cluster->first, text_index);
-    cluster->sub_clusters = sub_cluster;
-    cluster->sub_cluster_count = 1;
-            
-    for (int j = 1; j < cluster->count; j++) {
-        CMU_Entry* entry = &cluster->first[j];
-        
-        if (entry->key.length <= text_index) {
-            sub_cluster->count += 1;
-            continue;
-        } 
-        
-        if (sub_cluster->c != entry->key.text[text_index]) {
-            sub_cluster = InsertCluster(dict, entry, text_index);
-            cluster->sub_cluster_count += 1;
-        } else {
-            sub_cluster->count += 1;
-        }
-    }        
+inline u8* EntryPhones(CMU_Dictionary* dict, CMU_Entry* entry) {
+    return dict->phones + entry->phones_offset;
 }
 
-// In order to generate clusters correctly for search, the input file (cmudict.dict) must be 
-// alphabetically sorted otherwise the search functions are extremely likely to fail.
+inline u8* EntryUnits(CMU_Dictionary* dict, CMU_Entry* entry) {
+    return dict->units + entry->units_offset;
+}
 
-bool LoadDictionary(const char* filepath, CMU_Dictionary* dict, Allocator allocator) {
-    MemoryBuffer mb = {};
-    if (!ReadEntireFileAndNullTerminate(filepath, &mb, allocator)) {
-        fprintf(stderr, "Failed to read %s.\n", filepath);
+// Phones are returned as a token into the dictionary strings. It is not null terminated, and empty
+// when the dictionary has no text (use EntryPhones instead).
+inline ParsedToken EntryValueToken(CMU_Dictionary* dict, CMU_Entry* entry) {
+    ParsedToken token = {};
+    token.type = ParsedTokenType_Series;
+    token.text = EntryValue(dict, entry);
+    token.length = entry->value_length;
+    return token;
+}
+
+// Chunk of the dictionary text parsed by one worker of LoadDictionary.
+struct DictionaryChunk {
+    const char* buffer;
+    size_t begin;
+    size_t end;
+    
+    CMU_Entry* entries;  // slice of CMU_Dictionary::entries
+    int capacity;
+    int count;
+    Allocator allocator;
+};
+
+internal void CountDictionaryChunk(void* data) {
+    DictionaryChunk* chunk = (DictionaryChunk*)data;
+    chunk->capacity = CountDictionaryLines(chunk->buffer, chunk->begin, chunk->end);
+}
+
+internal void ParseDictionaryChunk(void* data) {
+    DictionaryChunk* chunk = (DictionaryChunk*)data;
+    // capacity is the chunk's line count, so the slice never needs to grow.
+    chunk->count = ParseDictionaryEntries(chunk->buffer, chunk->begin, chunk->end, &chunk->entries, &chunk->capacity, 0, chunk->allocator);
+}
+
+// Splits the text at line boundaries and parses each chunk on its own thread: one pass counts the
+// lines of every chunk to place its slice of entries, a second fills the slices in.
+internal bool ParseDictionaryParallel(CMU_Dictionary* dict, MemoryBuffer* mb, Allocator allocator, u32 thread_count) {
+    const u32 MAX_LOAD_THREADS = 64;
+    DictionaryChunk chunks[MAX_LOAD_THREADS];
+    if (thread_count > MAX_LOAD_THREADS) thread_count = MAX_LOAD_THREADS;
+    
+    size_t begin = 0;
+    for (u32 i = 0; i < thread_count; i++) {
+        size_t end = (i + 1 == thread_count) ? mb->size : (mb->size * (i + 1)) / thread_count;
+        if (end < begin) end = begin;
+        while (end > 0 && end < mb->size && mb->buffer[end - 1] != '\n') {
+            end++;
+        }
+        
+        DictionaryChunk* chunk = &chunks[i];
+        ZeroStruct(chunk);
+        chunk->buffer = mb->buffer;
+        chunk->begin = begin;
+        chunk->end = end;
+        chunk->allocator = allocator;
+        begin = end;
+    }
+    
+    RunInParallel(CountDictionaryChunk, chunks, sizeof(DictionaryChunk), thread_count);
+    
+    int capacity = 0;
+    for (u32 i = 0; i < thread_count; i++) {
+        capacity += chunks[i].capacity;
+    }
+    
+    dict->entries = ALLOC_ARRAY(allocator, CMU_Entry, capacity > 0 ? capacity : 1);
+    if (dict->entries == 0) {
         return false;
     }
     
-    char* current = mb.buffer;
-    for (;;) {
-        if (current[0] == 0) {
-            break;
-        } else if (current[0] == '\n') {
-            dict->entry_count += 1;
+    int offset = 0;
+    for (u32 i = 0; i < thread_count; i++) {
+        chunks[i].entries = dict->entries + offset;
+        offset += chunks[i].capacity;
+    }
+    
+    RunInParallel(ParseDictionaryChunk, chunks, sizeof(DictionaryChunk), thread_count);
+    
+    // Close the gaps left by blank lines.
+    dict->entry_count = 0;
+    for (u32 i = 0; i < thread_count; i++) {
+        if (chunks[i].count < 0) {
+            return false;
         }
-        current++;
+        if (chunks[i].entries != dict->entries + dict->entry_count) {
+            memmove(dict->entries + dict->entry_count, chunks[i].entries, chunks[i].count * sizeof(CMU_Entry));
+        }
+        dict->entry_count += chunks[i].count;
     }
-
-    printf("Found %d entries in %s\n", dict->entry_count, filepath);
-    dict->entries = (CMU_Entry*)allocator.alloc(dict->entry_count * sizeof(CMU_Entry));
     
-    int current_entry = 0;
+    return true;
+}
 
-    Tokenizer tokenizer = {};
-    tokenizer.at = mb.buffer;
-    for (;;) {
-        ParsedToken token = NextToken(&tokenizer);
-        if (token.type == ParsedTokenType_EndOfStream) {
-            break;
+// Converts the text pronunciation of every entry into packed phone ids.
+bool EncodeDictionaryPhones(CMU_Dictionary* dict, Allocator allocator) {
+    // Each phone takes at least one character plus a separator, so this always fits.
+    u64 capacity = 0;
+    for (int i = 0; i < dict->entry_count; i++) {
+        capacity += dict->entries[i].value_length / 2 + 1;
+    }
+    
+    dict->phones = ALLOC_ARRAY(allocator, u8, capacity);
+    if (dict->phones == 0) {
+        return false;
+    }
+    
+    u32 at = 0;
+    for (int i = 0; i < dict->entry_count; i++) {
+        CMU_Entry* entry = &dict->entries[i];
+        int max_phones = entry->value_length / 2 + 1;
+        if (max_phones > 0xFF) {
+            max_phones = 0xFF;
         }
         
-        CMU_Entry* entry = &dict->entries[current_entry];
-        entry->key = token;
-        entry->value = NextTokenLine(&tokenizer);
-        current_entry++;
+        entry->phones_offset = at;
+        entry->phone_count = (u8)EncodePhones(EntryValue(dict, entry), entry->value_length, dict->phones + at, max_phones);
+        at += entry->phone_count;
     }
+    dict->phones_size = at;
     
-    // Build the acceleration structure for look-up
-    {
-        dict->clusters = (CMU_Cluster*)HeapAlloc(MAX_CMU_CLUSTERS * sizeof(CMU_Cluster));
-        
-        dict->root_cluster.first = &dict->entries[0];
-        dict->root_cluster.c = dict->entries[0].key.text[0];
-        dict->root_cluster.count = dict->entry_count;
+    return true;
+}
+
+// Converts packed phones into unit ids and returns the unit count. Never writes more units than
+// there are phones.
+typedef int (*PhoneUnitMapper)(const u8* phones, int phone_count, u8* units);
+
+// Runs mapper over every entry once and stores the result, so translating a word becomes a
+// look-up plus a copy of its unit ids. The dictionary itself doesn't know what the units mean.
+bool PrecompileDictionaryUnits(CMU_Dictionary* dict, PhoneUnitMapper mapper, Allocator allocator) {
+    PROFILE_ZONE("phone mapping");
+    dict->units = ALLOC_ARRAY(allocator, u8, dict->phones_size > 0 ? dict->phones_size : 1);
+    if (dict->units == 0) {
+        return false;
+    }
+    
+    u32 at = 0;
+    for (int i = 0; i < dict->entry_count; i++) {
+        CMU_Entry* entry = &dict->entries[i];
+        int unit_count = mapper(EntryPhones(dict, entry), entry->phone_count, dict->units + at);
+        assert(unit_count <= entry->phone_count);
         
-        BuildSubClusters(dict, &dict->root_cluster, 0);
+        entry->units_offset = at;
+        entry->unit_count = (u8)unit_count;
+        at += unit_count;
+    }
+    dict->units_size = at;
+    dict->has_units = true;
+    
+    return true;
+}
+
+#define CMU_BUILD_SCRATCH_SIZE ((size_t)1 << 30)
 
-        for (int i = 0; i < dict->root_cluster.sub_cluster_count; i++) {
-            CMU_Cluster* cluster = &dict->root_cluster.sub_clusters[i];
-            BuildSubClusters(dict, cluster, 1);
+// Address space for build temporaries. Everything in it is dropped at once with ReleaseArena, so a
+// long-lived dictionary arena only keeps what the dictionary uses. Falls back to the heap.
+internal Allocator BeginBuildScratch(Arena* arena) {
+    return ReserveArena(arena, CMU_BUILD_SCRATCH_SIZE) ? ArenaAllocator(arena) : HeapAllocator;
+}
+
+// thread_count > 1 parses the text and builds the trie on that many threads.
+bool LoadDictionary(const char* filepath, CMU_Dictionary* dict, Allocator allocator, u32 thread_count = 1) {
+    PROFILE_ZONE("load dictionary");
+    MemoryBuffer mb = {};
+    if (!ReadEntireFileAndNullTerminate(filepath, &mb, allocator)) {
+        fprintf(stderr, "Failed to read %s.\n", filepath);
+        return false;
+    }
+    
+    bool parsed = false;
+    if (thread_count > 1) {
+        parsed = ParseDictionaryParallel(dict, &mb, allocator, thread_count);
+    } else {
+        // Rough guess of one entry per 24 bytes so the array rarely has to grow.
+        int capacity = (int)(mb.size / 24) + 1;
+        dict->entries = ALLOC_ARRAY(allocator, CMU_Entry, capacity);
+        if (dict->entries) {
+            dict->entry_count = ParseDictionaryEntries(mb.buffer, 0, mb.size, &dict->entries, &capacity, 0, allocator);
+            parsed = dict->entry_count >= 0;
         }
     }
     
+    if (!parsed) {
+        fprintf(stderr, "Out of memory while parsing %s.\n", filepath);
+        return false;
+    }
+    
+    // stderr, so it never mixes with program output such as server responses.
+    fprintf(stderr, "Found %d entries in %s\n", dict->entry_count, filepath);
+    dict->strings = mb.buffer;
+    dict->strings_size = (u32)mb.size;
+    
+    if (!EncodeDictionaryPhones(dict, allocator)) {
+        fprintf(stderr, "Out of memory while encoding the phones of %s.\n", filepath);
+        return false;
+    }
+    
+    // Build the acceleration structure for look-up. Its temporaries don't stay in allocator.
+    Arena scratch_arena;
+    Allocator scratch = BeginBuildScratch(&scratch_arena);
+    bool built = BuildRadixTrie(&dict->trie, dict->entries, dict->entry_count, dict->strings, allocator, scratch, thread_count);
+    ReleaseArena(&scratch_arena);
+    if (!built) {
+        fprintf(stderr, "Failed to build the look-up trie for %s.\n", filepath);
+        return false;
+    }
+    
     return true;
 }
 
 // SLOW version! Use GetPhones() instead.
-// This is used to demonstrate speed differences between linear search and the Cluster data structure.
+// This is used to demonstrate speed differences between linear search and the look-up engines.
 bool GetPhonesLinear(CMU_Dictionary* dict, const char* search, ParsedToken* token) {
     int search_length = CStringLength(search);
     
-    for (int i = 0; dict->entry_count; i++) {
+    for (int i = 0; i < dict->entry_count; i++) {
         CMU_Entry* entry = &dict->entries[i];
-        if (StringEquals(search, search_length, entry->key.text, entry->key.length)) {
-            *token = entry->value;
+        if (StringEquals(search, search_length, EntryKey(dict, entry), entry->key_length)) {
+            *token = EntryValueToken(dict, entry);
             return true;
         }
     }
@@ -145,39 +377,126 @@ bool GetPhonesLinear(CMU_Dictionary* dict, const char* search, ParsedToken* toke
     return false;
 }
 
+internal bool BuildLookupIndexWith(CMU_Dictionary* dict, CMU_LookupEngine engine, Allocator allocator, Allocator scratch) {
+    switch (engine) {
+        case CMU_Lookup_Trie: {
+            if (dict->trie.nodes == 0 && 
+                !BuildRadixTrie(&dict->trie, dict->entries, dict->entry_count, dict->strings, allocator, scratch)) {
+                return false;
+            }
+        } break;
+        
+        case CMU_Lookup_Hash: {
+            if (dict->hash_index.slots == 0 && 
+                !BuildHashIndex(&dict->hash_index, dict->entries, dict->entry_count, dict->strings, allocator)) {
+                return false;
+            }
+        } break;
+        
+        case CMU_Lookup_PerfectHash: {
+            if (dict->perfect_hash_index.slots == 0 && 
+                !BuildPerfectHashIndex(&dict->perfect_hash_index, dict->entries, dict->entry_count, dict->strings, allocator, scratch)) {
+                return false;
+            }
+        } break;
+        
+        case CMU_Lookup_Eytzinger: {
+            if (dict->eytzinger_index.prefixes == 0 && 
+                !BuildEytzingerIndex(&dict->eytzinger_index, dict->entries, dict->entry_count, dict->strings, allocator, scratch)) {
+                return false;
+            }
+        } break;
+        
+        default: {
+            return false;
+        }
+    }
+    
+    dict->engine = engine;
+    return true;
+}
+
+// Builds the look-up structure for engine (if needed) and makes it the one GetPhones uses.
+// Works for dictionaries loaded from text or from an image. Only the finished index comes from
+// allocator; build temporaries go to a scratch arena that is released before returning.
+bool BuildLookupIndex(CMU_Dictionary* dict, CMU_LookupEngine engine, Allocator allocator) {
+    Arena scratch_arena;
+    Allocator scratch = BeginBuildScratch(&scratch_arena);
+    bool success = BuildLookupIndexWith(dict, engine, allocator, scratch);
+    ReleaseArena(&scratch_arena);
+    return success;
+}
+
+// Bytes used by the look-up structure of engine (0 if it isn't built), on top of the entries and
+// strings every engine shares.
+u64 LookupIndexSize(CMU_Dictionary* dict, CMU_LookupEngine engine) {
+    switch (engine) {
+        case CMU_Lookup_Trie: {
+            return (u64)dict->trie.node_count * (sizeof(CMU_TrieNode) + sizeof(char));
+        }
+        case CMU_Lookup_Hash: {
+            return dict->hash_index.slots ? ((u64)dict->hash_index.mask + 1) * sizeof(CMU_HashSlot) : 0;
+        }
+        case CMU_Lookup_PerfectHash: {
+            CMU_PerfectHashIndex* index = &dict->perfect_hash_index;
+            return index->slots ? (u64)index->bucket_count * sizeof(u16) + (u64)index->table_size * sizeof(u32) : 0;
+        }
+        case CMU_Lookup_Eytzinger: {
+            CMU_EytzingerIndex* index = &dict->eytzinger_index;
+            return index->prefixes ? ((u64)index->count + 1) * (sizeof(u64) + sizeof(u32)) : 0;
+        }
+        default: {
+            return 0;
+        }
+    }
+}
+
+// Returns the index of the entry for search (length bytes, no null terminator needed) or -1.
+int FindEntry(CMU_Dictionary* dict, const char* search, int length) {
+    switch (dict->engine) {
+        case CMU_Lookup_Hash:        return FindInHashIndex(&dict->hash_index, dict->entries, dict->strings, search, length);
+        case CMU_Lookup_PerfectHash: return FindInPerfectHashIndex(&dict->perfect_hash_index, dict->entries, dict->strings, search, length);
+        case CMU_Lookup_Eytzinger:   return FindInEytzingerIndex(&dict->eytzinger_index, dict->entries, dict->strings, search, length);
+        default:                     return FindInRadixTrie(&dict->trie, dict->strings, search, length);
+    }
+}
+
 bool GetPhones(CMU_Dictionary* dict, const char* search, ParsedToken* token) {
-    int search_length = CStringLength(search);
+    int index = FindEntry(dict, search, CStringLength(search));
+    if (index < 0) {
+        return false;
+    }
     
-    CMU_Cluster* root_cluster = &dict->root_cluster;
+    *token = EntryValueToken(dict, &dict->entries[index]);
+    return true;
+}
+
+// Looks up the precompiled unit ids for search. Requires PrecompileDictionaryUnits (or an image
+// compiled with units).
+bool GetUnits(CMU_Dictionary* dict, const char* search, int length, const u8** units, int* unit_count) {
+    assert(dict->has_units);
+    int index = FindEntry(dict, search, length);
+    if (index < 0) {
+        return false;
+    }
     
-    for (int i = 0; i < root_cluster->sub_cluster_count; i++) {
-        CMU_Cluster* cluster = &root_cluster->sub_clusters[i];
-        if (cluster->c == search[0]) {
-            for (int j = 0; j < cluster->sub_cluster_count; j++) {
-                CMU_Cluster* sub_cluster = &cluster->sub_clusters[j];
+    CMU_Entry* entry = &dict->entries[index];
+    *units = EntryUnits(dict, entry);
+    *unit_count = entry->unit_count;
+    return true;
+}
 
-                char c = ' ';
-                int text_index = 1;
-                if (search_length > text_index) {
-                    c = search[text_index];
-                }
-                
-                if (sub_cluster->c != c) {
-                    continue;
-                }
-                
-                for (int k = 0; k < sub_cluster->count; k++) {
-                    CMU_Entry* entry = &sub_cluster->first[k];
-                    if (StringEquals(search, search_length, entry->key.text, entry->key.length)) {
-                        *token = entry->value;
-                        return true;
-                    }
-                }
-            }
-        }
+// Same look-up as GetPhones, but returns the pre-encoded phones instead of the text.
+bool GetPhoneIds(CMU_Dictionary* dict, const char* search, int length, const u8** phones, int* phone_count) {
+    int index = FindEntry(dict, search, length);
+    if (index < 0) {
+        return false;
     }
     
-    return false;
+    CMU_Entry* entry = &dict->entries[index];
+    *phones = EntryPhones(dict, entry);
+    *phone_count = entry->phone_count;
+    return true;
 }
 
 #endif // _CMU_DICTIONARY_H_
\ No newline at end of file
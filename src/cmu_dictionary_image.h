@@ -0,0 +1,339 @@
+#ifndef _CMU_DICTIONARY_IMAGE_H_
+#define _CMU_DICTIONARY_IMAGE_H_
+
+#include "cmu_dictionary.h"
+#include "alien_speech_data.h"
+
+// Precompiled CMU_Dictionary image.
+//
+// The image is the dictionary arrays written out verbatim behind a small header. Since entries
+// and the radix trie only use offsets/indices, loading is a single mmap plus pointer fix-ups for
+// the section bases: no parsing and no trie build. The image is written in native byte order
+// and is meant to be compiled for the machine (or platform) that reads it.
+//
+// The header records the size and modification time of the text dictionary it was compiled from.
+// LoadDictionaryImage rejects an image whose source has changed since, so the caller falls back
+// to the text dictionary instead of silently using stale pronunciations. It also records
+// alien_speech_fingerprint: the packed phones and the units are ids from symbols.xmacro, so an
+// image compiled before the symbols or the unit mapping changed is rejected the same way.
+//
+// Layout (each section starts on a CMU_IMAGE_ALIGNMENT boundary):
+//     CMU_ImageHeader
+//     CMU_Entry[entry_count]
+//     CMU_TrieNode[node_count]
+//     char[node_count]    (trie edge_chars)
+//     char[strings_size]  (key\0 for every entry, key\0value\0 if has_text)
+//     u8[phones_size]     (packed phones, see arpabet.h)
+//     u8[units_size]      (precompiled unit ids, only if has_units)
+
+#define CMU_IMAGE_MAGIC   0x44554D43 // "CMUD"
+#define CMU_IMAGE_VERSION 7
+#define CMU_IMAGE_ALIGNMENT 64
+
+struct CMU_ImageHeader {
+    u32 magic;
+    u32 version;
+
+    u32 entry_count;
+    u32 node_count;
+    u32 strings_size;
+    u32 phones_size;
+    u32 units_size;
+    u32 has_units;
+    u32 has_text;       // Pronunciation text next to the keys, only for tools that show it.
+    u32 symbols_fingerprint; // alien_speech_fingerprint when the image was compiled.
+
+    // GetFileStamp of the text dictionary, 0 if unknown.
+    u64 source_size;
+    u64 source_modified;
+
+    // Byte offsets from the start of the file.
+    u64 entries_offset;
+    u64 nodes_offset;
+    u64 edge_chars_offset;
+    u64 strings_offset;
+    u64 phones_offset;
+    u64 units_offset;
+};
+
+// Writes a loaded dictionary (from text or from another image) to filepath.
+// The strings section is compacted so only the keys and values are stored, and the trie is
+// rebuilt so its labels point into the compacted strings. source_filepath is the text dictionary
+// the image stands in for; its stamp is stored so a later edit invalidates the image.
+// The pronunciation text is only stored with keep_text: look-ups and translation use the packed
+// phones, so by default every value is empty and the strings section only holds the keys.
+bool SaveDictionaryImage(CMU_Dictionary* dict, const char* filepath, const char* source_filepath, Allocator allocator,
+                         bool keep_text = false) {
+    keep_text = keep_text && dict->has_text;
+    u32 strings_size = 0;
+    for (int i = 0; i < dict->entry_count; i++) {
+        strings_size += dict->entries[i].key_length + 1;
+        if (keep_text) {
+            strings_size += dict->entries[i].value_length + 1;
+        }
+    }
+
+    CMU_Entry* entries = ALLOC_ARRAY(allocator, CMU_Entry, dict->entry_count);
+    char* strings = ALLOC_ARRAY(allocator, char, strings_size);
+    if (entries == 0 || strings == 0) {
+        fprintf(stderr, "Out of memory while compiling %s.\n", filepath);
+        return false;
+    }
+    // CMU_Entry has tail padding, zeroed so the same dictionary always compiles to the same file.
+    ZeroArray(entries, dict->entry_count);
+
+    u32 at = 0;
+    for (int i = 0; i < dict->entry_count; i++) {
+        CMU_Entry* src = &dict->entries[i];
+        CMU_Entry* dest = &entries[i];
+
+        dest->key_offset = at;
+        dest->key_length = src->key_length;
+        memcpy(strings + at, EntryKey(dict, src), src->key_length);
+        at += src->key_length;
+        strings[at++] = 0;
+
+        // Without the text, values are the empty string at the end of the key.
+        if (keep_text) {
+            dest->value_offset = at;
+            dest->value_length = src->value_length;
+            memcpy(strings + at, EntryValue(dict, src), src->value_length);
+            at += src->value_length;
+            strings[at++] = 0;
+        } else {
+            dest->value_offset = at - 1;
+            dest->value_length = 0;
+        }
+
+        // The phones are already compact, so their offsets carry over unchanged.
+        dest->phones_offset = src->phones_offset;
+        dest->phone_count = src->phone_count;
+        dest->units_offset = src->units_offset;
+        dest->unit_count = src->unit_count;
+    }
+
+    CMU_RadixTrie trie = {};
+    if (!BuildRadixTrie(&trie, entries, dict->entry_count, strings, allocator, allocator)) {
+        fprintf(stderr, "Failed to build the look-up trie for %s.\n", filepath);
+        return false;
+    }
+
+    CMU_ImageHeader header = {};
+    header.magic = CMU_IMAGE_MAGIC;
+    header.version = CMU_IMAGE_VERSION;
+    header.entry_count = dict->entry_count;
+    header.node_count = trie.node_count;
+    header.strings_size = strings_size;
+    header.phones_size = dict->phones_size;
+    header.has_units = dict->has_units;
+    header.has_text = keep_text;
+    header.symbols_fingerprint = alien_speech_fingerprint;
+    header.units_size = dict->has_units ? dict->units_size : 0;
+    if (source_filepath && !GetFileStamp(source_filepath, &header.source_size, &header.source_modified)) {
+        header.source_size = 0;
+        header.source_modified = 0;
+    }
+
+    u64 position = sizeof(CMU_ImageHeader);
+    position = AlignUp(position, CMU_IMAGE_ALIGNMENT);
+    header.entries_offset = position;
+    position += dict->entry_count * sizeof(CMU_Entry);
+    position = AlignUp(position, CMU_IMAGE_ALIGNMENT);
+    header.nodes_offset = position;
+    position += trie.node_count * sizeof(CMU_TrieNode);
+    position = AlignUp(position, CMU_IMAGE_ALIGNMENT);
+    header.edge_chars_offset = position;
+    position += trie.node_count;
+    position = AlignUp(position, CMU_IMAGE_ALIGNMENT);
+    header.strings_offset = position;
+    position += strings_size;
+    position = AlignUp(position, CMU_IMAGE_ALIGNMENT);
+    header.phones_offset = position;
+    position += dict->phones_size;
+    position = AlignUp(position, CMU_IMAGE_ALIGNMENT);
+    header.units_offset = position;
+
+    bool success = false;
+    FILE* file = fopen(filepath, "wb");
+    if (file) {
+        position = 0;
+        success = fwrite(&header, sizeof(header), 1, file) == 1;
+        position += sizeof(header);
+
+        success = success && WritePadding(file, &position, CMU_IMAGE_ALIGNMENT);
+        success = success && fwrite(entries, sizeof(CMU_Entry), dict->entry_count, file) == (size_t)dict->entry_count;
+        position += dict->entry_count * sizeof(CMU_Entry);
+
+        success = success && WritePadding(file, &position, CMU_IMAGE_ALIGNMENT);
+        success = success && fwrite(trie.nodes, sizeof(CMU_TrieNode), trie.node_count, file) == trie.node_count;
+        position += trie.node_count * sizeof(CMU_TrieNode);
+
+        success = success && WritePadding(file, &position, CMU_IMAGE_ALIGNMENT);
+        success = success && fwrite(trie.edge_chars, 1, trie.node_count, file) == trie.node_count;
+        position += trie.node_count;
+
+        success = success && WritePadding(file, &position, CMU_IMAGE_ALIGNMENT);
+        success = success && fwrite(strings, 1, strings_size, file) == strings_size;
+        position += strings_size;
+
+        success = success && WritePadding(file, &position, CMU_IMAGE_ALIGNMENT);
+        success = success && fwrite(dict->phones, 1, dict->phones_size, file) == dict->phones_size;
+        position += dict->phones_size;
+
+        success = success && WritePadding(file, &position, CMU_IMAGE_ALIGNMENT);
+        success = success && fwrite(dict->units, 1, header.units_size, file) == header.units_size;
+
+        success = (fclose(file) == 0) && success;
+    }
+
+    if (!success) {
+        fprintf(stderr, "Failed to write %s.\n", filepath);
+    }
+
+    if (allocator.free) {
+        allocator.free(allocator.context, entries);
+        allocator.free(allocator.context, strings);
+        allocator.free(allocator.context, trie.nodes);
+        allocator.free(allocator.context, trie.edge_chars);
+    }
+    return success;
+}
+
+internal bool ImageSectionFits(u64 offset, u64 size, u64 image_size) {
+    return offset <= image_size && size <= image_size - offset && offset % CMU_IMAGE_ALIGNMENT == 0;
+}
+
+internal bool ImageRangeFits(u64 offset, u64 count, u64 section_size) {
+    return offset <= section_size && count <= section_size - offset;
+}
+
+// The section extents are checked against the file, but the entries and the trie hold offsets
+// into the other sections that look-ups follow blindly. One pass over both makes a corrupt or
+// mismatched image fail to load instead of reading out of bounds later.
+internal bool ImageContentsAreValid(const CMU_ImageHeader* header, const u8* data) {
+    const CMU_Entry* entries = (const CMU_Entry*)(data + header->entries_offset);
+    const CMU_TrieNode* nodes = (const CMU_TrieNode*)(data + header->nodes_offset);
+    const u8* phones = data + header->phones_offset;
+    const u8* units = data + header->units_offset;
+
+    // Keys and values are followed by their terminator.
+    for (u32 i = 0; i < header->entry_count; i++) {
+        const CMU_Entry* entry = &entries[i];
+        bool valid = ImageRangeFits(entry->key_offset, (u64)entry->key_length + 1, header->strings_size) &&
+                     ImageRangeFits(entry->value_offset, (u64)entry->value_length + 1, header->strings_size) &&
+                     ImageRangeFits(entry->phones_offset, entry->phone_count, header->phones_size) &&
+                     (!header->has_units || ImageRangeFits(entry->units_offset, entry->unit_count, header->units_size));
+        if (!valid) {
+            return false;
+        }
+    }
+
+    // Children always come after their parent and every label but the root's is at least one
+    // byte, so a look-up can't loop.
+    if (header->node_count == 0) {
+        return false;
+    }
+    for (u32 i = 0; i < header->node_count; i++) {
+        const CMU_TrieNode* node = &nodes[i];
+        bool valid = ImageRangeFits(node->label_offset, node->label_length, header->strings_size) &&
+                     (i == 0 || node->label_length > 0) &&
+                     (node->entry == TRIE_NO_ENTRY || (node->entry >= 0 && (u32)node->entry < header->entry_count)) &&
+                     (node->child_count == 0 ||
+                      (node->first_child > i && ImageRangeFits(node->first_child, node->child_count, header->node_count)));
+        if (!valid) {
+            return false;
+        }
+    }
+
+    // Phone and unit ids index fixed tables.
+    for (u32 i = 0; i < header->phones_size; i++) {
+        if (PhoneId(phones[i]) >= Phone_Count) {
+            return false;
+        }
+    }
+    for (u32 i = 0; i < header->units_size; i++) {
+        if (units[i] >= Unit_Count) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Maps a precompiled image as a ready to use dictionary.
+// The dictionary is read-only and stays valid until UnloadDictionaryImage. When source_filepath
+// exists and no longer matches the stamp in the image, the image is stale and is not loaded.
+bool LoadDictionaryImage(const char* filepath, CMU_Dictionary* dict, const char* source_filepath = 0) {
+    PROFILE_ZONE("load dictionary image");
+    MappedFile image = {};
+    if (!MapFileReadOnly(filepath, &image)) {
+        fprintf(stderr, "Failed to map %s.\n", filepath);
+        return false;
+    }
+
+    bool valid = image.size >= sizeof(CMU_ImageHeader);
+    CMU_ImageHeader* header = (CMU_ImageHeader*)image.data;
+    if (valid) {
+        valid = header->magic == CMU_IMAGE_MAGIC && header->version == CMU_IMAGE_VERSION;
+    }
+    if (valid) {
+        u64 size = image.size;
+        valid = ImageSectionFits(header->entries_offset, (u64)header->entry_count * sizeof(CMU_Entry), size) &&
+                ImageSectionFits(header->nodes_offset, (u64)header->node_count * sizeof(CMU_TrieNode), size) &&
+                ImageSectionFits(header->edge_chars_offset, header->node_count, size) &&
+                ImageSectionFits(header->strings_offset, header->strings_size, size) &&
+                ImageSectionFits(header->phones_offset, header->phones_size, size) &&
+                ImageSectionFits(header->units_offset, header->units_size, size) &&
+                header->entry_count <= (u32)0x7FFFFFFF;
+    }
+
+    if (!valid) {
+        fprintf(stderr, "%s is not a compatible dictionary image (expected version %d).\n", filepath, CMU_IMAGE_VERSION);
+        UnmapFile(&image);
+        return false;
+    }
+
+    if (header->symbols_fingerprint != alien_speech_fingerprint) {
+        fprintf(stderr, "%s was compiled for other speech symbols, ignoring the image.\n", filepath);
+        UnmapFile(&image);
+        return false;
+    }
+
+    u64 source_size = 0;
+    u64 source_modified = 0;
+    if (source_filepath && GetFileStamp(source_filepath, &source_size, &source_modified) &&
+        (source_size != header->source_size || source_modified != header->source_modified)) {
+        fprintf(stderr, "%s changed since %s was compiled, ignoring the image.\n", source_filepath, filepath);
+        UnmapFile(&image);
+        return false;
+    }
+
+    if (!ImageContentsAreValid(header, image.data)) {
+        fprintf(stderr, "%s is corrupt, ignoring the image.\n", filepath);
+        UnmapFile(&image);
+        return false;
+    }
+
+    dict->entry_count = header->entry_count;
+    dict->entries = (CMU_Entry*)(image.data + header->entries_offset);
+    dict->strings = (char*)(image.data + header->strings_offset);
+    dict->strings_size = header->strings_size;
+    dict->has_text = header->has_text != 0;
+    dict->phones = image.data + header->phones_offset;
+    dict->phones_size = header->phones_size;
+    dict->has_units = header->has_units != 0;
+    dict->units = image.data + header->units_offset;
+    dict->units_size = header->units_size;
+    dict->trie.node_count = header->node_count;
+    dict->trie.nodes = (CMU_TrieNode*)(image.data + header->nodes_offset);
+    dict->trie.edge_chars = (char*)(image.data + header->edge_chars_offset);
+    dict->image = image;
+
+    return true;
+}
+
+void UnloadDictionaryImage(CMU_Dictionary* dict) {
+    UnmapFile(&dict->image);
+    *dict = {};
+}
+
+#endif // _CMU_DICTIONARY_IMAGE_H_
@@ -0,0 +1,155 @@
+#ifndef _CMU_DICTIONARY_PARSER_H_
+#define _CMU_DICTIONARY_PARSER_H_
+
+// Single pass cmudict.dict parser.
+// Included by cmu_dictionary.h after CMU_Entry is defined.
+//
+// Every line is "key<space>phones...<newline>". Instead of stepping through the buffer a byte at
+// a time, the parser compares 32 (AVX2) or 16 (SSE2) bytes at once against the separators and
+// jumps straight to the end of the key and the end of the line with a bit scan. Builds without
+// SSE2 use the same loop with a scalar search.
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define DICT_PARSE_WIDTH 32
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+    #include <emmintrin.h>
+    #define DICT_PARSE_WIDTH 16
+#else
+    #define DICT_PARSE_WIDTH 0
+#endif
+
+inline bool IsKeySeparator(char c) {
+    return c == ' ' || c == '\t' || c == '\n';
+}
+
+#if DICT_PARSE_WIDTH == 32
+
+// Bit i is set when block[i] is '\n' (or ' '/'\t' as well if key_end).
+inline u32 FindSeparatorMask(const char* block, bool key_end) {
+    __m256i bytes = _mm256_loadu_si256((const __m256i*)block);
+    __m256i match = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n'));
+    if (key_end) {
+        match = _mm256_or_si256(match, _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' ')));
+        match = _mm256_or_si256(match, _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\t')));
+    }
+    return (u32)_mm256_movemask_epi8(match);
+}
+
+#elif DICT_PARSE_WIDTH == 16
+
+inline u32 FindSeparatorMask(const char* block, bool key_end) {
+    __m128i bytes = _mm_loadu_si128((const __m128i*)block);
+    __m128i match = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n'));
+    if (key_end) {
+        match = _mm_or_si128(match, _mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')));
+        match = _mm_or_si128(match, _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\t')));
+    }
+    return (u32)_mm_movemask_epi8(match);
+}
+
+#endif
+
+// Returns the position of the next '\n' (or key separator if key_end) in [at, end), or end.
+inline size_t FindNextSeparator(const char* buffer, size_t at, size_t end, bool key_end) {
+#if DICT_PARSE_WIDTH
+    while (at + DICT_PARSE_WIDTH <= end) {
+        u32 mask = FindSeparatorMask(buffer + at, key_end);
+        if (mask) {
+            return at + CountTrailingZeros32(mask);
+        }
+        at += DICT_PARSE_WIDTH;
+    }
+#endif
+
+    while (at < end && buffer[at] != '\n' && !(key_end && IsKeySeparator(buffer[at]))) {
+        at++;
+    }
+    return at;
+}
+
+// Upper bound for the number of entries in buffer[begin, end): the number of lines.
+int CountDictionaryLines(const char* buffer, size_t begin, size_t end) {
+    int count = 0;
+    size_t at = begin;
+#if DICT_PARSE_WIDTH
+    while (at + DICT_PARSE_WIDTH <= end) {
+        count += PopCount32(FindSeparatorMask(buffer + at, false));
+        at += DICT_PARSE_WIDTH;
+    }
+#endif
+    for (; at < end; at++) {
+        count += buffer[at] == '\n';
+    }
+
+    if (end > begin && buffer[end - 1] != '\n') {
+        count++;
+    }
+    return count;
+}
+
+// Appends the entries of every line in buffer[begin, end) to *entries, growing it with allocator
+// when count reaches *capacity. Blank lines are skipped and a trailing '\r' is not part of the
+// phones. Returns the new entry count or -1 if the array could not grow.
+int ParseDictionaryEntries(const char* buffer, size_t begin, size_t end,
+                           CMU_Entry** entries, int* capacity, int count, Allocator allocator) {
+    size_t at = begin;
+    while (at < end) {
+        // Leading whitespace is rare, so this is usually a single compare.
+        while (at < end && (buffer[at] == ' ' || buffer[at] == '\t' || buffer[at] == '\r')) {
+            at++;
+        }
+        if (at >= end) {
+            break;
+        }
+        if (buffer[at] == '\n') {
+            at++;
+            continue;
+        }
+
+        size_t key_start = at;
+        size_t key_end = FindNextSeparator(buffer, at, end, true);
+
+        size_t value_start = key_end;
+        while (value_start < end && (buffer[value_start] == ' ' || buffer[value_start] == '\t')) {
+            value_start++;
+        }
+        size_t line_end = FindNextSeparator(buffer, value_start, end, false);
+
+        size_t value_end = line_end;
+        if (value_end > value_start && buffer[value_end - 1] == '\r') {
+            value_end--;
+        }
+        if (key_end > key_start && buffer[key_end - 1] == '\r') {
+            key_end--;
+        }
+
+        if (count == *capacity) {
+            int new_capacity = *capacity ? *capacity * 2 : 1024;
+            CMU_Entry* grown = (CMU_Entry*)allocator.realloc(allocator.context, *entries, new_capacity * sizeof(CMU_Entry));
+            if (grown == 0) {
+                return -1;
+            }
+            *entries = grown;
+            *capacity = new_capacity;
+        }
+
+        assert(key_end - key_start <= 0xFFFF && value_end - value_start <= 0xFFFF);
+
+        CMU_Entry* entry = &(*entries)[count++];
+        entry->key_offset = (u32)key_start;
+        entry->key_length = (u16)(key_end - key_start);
+        entry->value_offset = (u32)value_start;
+        entry->value_length = (u16)(value_end - value_start);
+        entry->phones_offset = 0;
+        entry->phone_count = 0;
+        entry->units_offset = 0;
+        entry->unit_count = 0;
+
+        at = line_end + 1;
+    }
+
+    return count;
+}
+
+#endif // _CMU_DICTIONARY_PARSER_H_
@@ -0,0 +1,132 @@
+#ifndef _CMU_EYTZINGER_H_
+#define _CMU_EYTZINGER_H_
+
+// Sorted keys in Eytzinger (BFS) order, searched with a binary search that is branchless except
+// for ties on the key prefix.
+// Included by cmu_dictionary.h after CMU_Entry and SortEntriesByKey are defined.
+//
+// Node k has its children at 2k and 2k+1 (1-based), so the top of the tree shares a handful of
+// cache lines and the lines needed a few levels down can be prefetched while the current level is
+// compared. Each key is represented by its first 8 bytes packed big-endian into a u64, so most
+// steps are a single integer compare that picks the child without a branch. When the prefixes tie
+// the step falls back to a data-dependent branch into CompareKeys. That happens on the levels
+// where a word of 8 or more letters meets another with the same first 8, so long words sharing a
+// stem pay a few unpredictable branches. Breaking ties without one would mean reading key bytes
+// on every level. ~17 steps for the 135k words in cmudict, using 12 bytes per key.
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64) || defined(_M_IX86)
+    #include <xmmintrin.h>
+    #define EytzingerPrefetch(address) _mm_prefetch((const char*)(address), _MM_HINT_T0)
+#elif defined(__GNUC__) || defined(__clang__)
+    #define EytzingerPrefetch(address) __builtin_prefetch(address)
+#else
+    #define EytzingerPrefetch(address)
+#endif
+
+struct CMU_EytzingerIndex {
+    u32 count;
+    u64* prefixes;  // [count + 1], 1-based, 64-byte aligned
+    u32* entries;   // [count + 1], 1-based
+    void* allocation;
+};
+
+inline u64 KeyPrefix64(const char* key, int length) {
+    u64 prefix = 0;
+    for (int i = 0; i < 8; i++) {
+        prefix <<= 8;
+        if (i < length) {
+            prefix |= (u8)key[i];
+        }
+    }
+    return prefix;
+}
+
+internal void FillEytzinger(CMU_EytzingerIndex* index, const u32* order, u32* at, u32 k) {
+    if (k > index->count) {
+        return;
+    }
+    FillEytzinger(index, order, at, 2 * k);
+    index->entries[k] = order[(*at)++];
+    FillEytzinger(index, order, at, 2 * k + 1);
+}
+
+// The sort order only lives while building and comes from scratch.
+bool BuildEytzingerIndex(CMU_EytzingerIndex* index, const CMU_Entry* entries, int entry_count, const char* strings,
+                         Allocator allocator, Allocator scratch_allocator) {
+    ZeroStruct(index);
+    index->count = (u32)entry_count;
+
+    u32 slots = index->count + 1;
+    size_t prefixes_size = slots * sizeof(u64);
+    index->allocation = allocator.alloc(allocator.context, 63 + prefixes_size + slots * sizeof(u32));
+    u32* order   = ALLOC_ARRAY(scratch_allocator, u32, entry_count);
+    u32* scratch = ALLOC_ARRAY(scratch_allocator, u32, entry_count);
+
+    bool success = index->allocation && order && scratch;
+    if (success) {
+        index->prefixes = (u64*)(((uintptr_t)index->allocation + 63) & ~(uintptr_t)63);
+        index->entries = (u32*)(index->prefixes + slots);
+
+        SortEntriesByKey(order, scratch, entries, entry_count, strings);
+
+        u32 at = 0;
+        FillEytzinger(index, order, &at, 1);
+
+        index->prefixes[0] = 0;
+        index->entries[0] = 0;
+        for (u32 k = 1; k <= index->count; k++) {
+            const CMU_Entry* entry = &entries[index->entries[k]];
+            index->prefixes[k] = KeyPrefix64(strings + entry->key_offset, entry->key_length);
+        }
+    }
+
+    if (scratch_allocator.free) {
+        scratch_allocator.free(scratch_allocator.context, order);
+        scratch_allocator.free(scratch_allocator.context, scratch);
+    }
+    if (!success && allocator.free) {
+        allocator.free(allocator.context, index->allocation);
+    }
+
+    if (!success) {
+        ZeroStruct(index);
+    }
+    return success;
+}
+
+// Returns the entry index for key or -1 if it isn't in the index.
+int FindInEytzingerIndex(const CMU_EytzingerIndex* index, const CMU_Entry* entries, const char* strings, const char* key, int length) {
+    u64 prefix = KeyPrefix64(key, length);
+    const u64* prefixes = index->prefixes;
+
+    // Lower bound: descend left while the node is >= key, right while it is < key.
+    u32 k = 1;
+    while (k <= index->count) {
+        // 8 prefixes per cache line: prefetch the line holding this node's great-grandchildren.
+        EytzingerPrefetch(prefixes + 8 * k);
+
+        u64 p = prefixes[k];
+        u32 less = p < prefix;
+        // The only branch in the descent, see the top of the file.
+        if (p == prefix) {
+            const CMU_Entry* entry = &entries[index->entries[k]];
+            less = CompareKeys(strings + entry->key_offset, entry->key_length, key, length) < 0;
+        }
+        k = 2 * k + less;
+    }
+
+    // Undo the trailing right turns (and the final left one) to land on the lower bound.
+    k >>= CountTrailingZeros32(~k) + 1;
+    if (k == 0) {
+        return -1;
+    }
+
+    u32 entry_index = index->entries[k];
+    const CMU_Entry* entry = &entries[entry_index];
+    if (prefixes[k] == prefix && StringEquals(key, length, strings + entry->key_offset, entry->key_length)) {
+        return (int)entry_index;
+    }
+    return -1;
+}
+
+#endif // _CMU_EYTZINGER_H_
@@ -0,0 +1,89 @@
+#ifndef _CMU_HASH_INDEX_H_
+#define _CMU_HASH_INDEX_H_
+
+// Open-addressing (linear probing) hash index over CMU_Entry keys.
+// Included by cmu_dictionary.h after CMU_Entry is defined.
+//
+// Each slot stores the full FNV1a_32 of its key next to the entry index, so a probe only
+// touches the key bytes when the 32-bit hashes match. A hash of 0 marks an empty slot; keys
+// that actually hash to 0 are stored as 1.
+
+struct CMU_HashSlot {
+    u32 hash;
+    u32 entry;
+};
+
+struct CMU_HashIndex {
+    u32 mask;  // capacity - 1, capacity is a power of 2.
+    CMU_HashSlot* slots;
+};
+
+inline u32 HashIndexKey(const char* key, int length) {
+    u32 hash = FNV1a_32(key, length);
+    return hash ? hash : 1;
+}
+
+bool BuildHashIndex(CMU_HashIndex* index, const CMU_Entry* entries, int entry_count, const char* strings, Allocator allocator) {
+    // Keep the load factor at or below 75% so probe sequences stay short.
+    u32 capacity = 16;
+    while (capacity < ((u64)entry_count * 4) / 3 + 1) {
+        capacity <<= 1;
+    }
+
+    index->slots = ALLOC_ARRAY(allocator, CMU_HashSlot, capacity);
+    if (index->slots == 0) {
+        return false;
+    }
+    ZeroArray(index->slots, capacity);
+    index->mask = capacity - 1;
+
+    for (int i = 0; i < entry_count; i++) {
+        const CMU_Entry* entry = &entries[i];
+        const char* key = strings + entry->key_offset;
+        u32 hash = HashIndexKey(key, entry->key_length);
+
+        u32 slot = hash & index->mask;
+        for (;;) {
+            CMU_HashSlot* s = &index->slots[slot];
+            if (s->hash == 0) {
+                s->hash = hash;
+                s->entry = (u32)i;
+                break;
+            }
+
+            // Duplicate keys keep the first entry, matching the order based look-ups.
+            if (s->hash == hash) {
+                const CMU_Entry* other = &entries[s->entry];
+                if (StringEquals(key, entry->key_length, strings + other->key_offset, other->key_length)) {
+                    break;
+                }
+            }
+            slot = (slot + 1) & index->mask;
+        }
+    }
+
+    return true;
+}
+
+// Returns the entry index for key or -1 if it isn't in the index.
+int FindInHashIndex(const CMU_HashIndex* index, const CMU_Entry* entries, const char* strings, const char* key, int length) {
+    u32 hash = HashIndexKey(key, length);
+    u32 slot = hash & index->mask;
+
+    for (;;) {
+        const CMU_HashSlot* s = &index->slots[slot];
+        if (s->hash == 0) {
+            return -1;
+        }
+
+        if (s->hash == hash) {
+            const CMU_Entry* entry = &entries[s->entry];
+            if (StringEquals(key, length, strings + entry->key_offset, entry->key_length)) {
+                return (int)s->entry;
+            }
+        }
+        slot = (slot + 1) & index->mask;
+    }
+}
+
+#endif // _CMU_HASH_INDEX_H_
@@ -0,0 +1,291 @@
+#ifndef _CMU_PERFECT_HASH_H_
+#define _CMU_PERFECT_HASH_H_
+
+// Minimal perfect hash (PTHash style) over CMU_Entry keys.
+// Included by cmu_dictionary.h after CMU_Entry is defined.
+//
+// Keys are hashed twice with FNV1a_32 (different seeds). The first hash picks a bucket, and every
+// bucket stores a 16-bit pilot chosen at build time so that Mix32(h0 ^ Mix32(pilot)) sends each of
+// its keys to a position nobody else uses. Positions are drawn from a table ~1% larger than the key
+// count to keep the pilot search short; positions past key_count are folded back into the unused
+// slots below key_count through remap, which makes the function minimal.
+//
+// The function itself costs ~3.2 bits per key (pilots) plus the small remap array. The entries
+// stay in file order (every engine shares them), so slots maps the final position to an entry
+// index at 32 bits per key: ~36 bits per key all told, still well below the open addressing hash.
+// A look-up is two hashes of the word, one probe and one key compare, whatever letters the word
+// starts with. Duplicate keys keep the first entry, like the other engines.
+
+#define PERFECT_HASH_KEYS_PER_BUCKET 5
+#define PERFECT_HASH_LOAD_FACTOR 0.99
+#define PERFECT_HASH_MAX_PILOT 0xFFFF
+#define PERFECT_HASH_MAX_ATTEMPTS 16
+
+struct CMU_PerfectHashIndex {
+    u32 seed;
+    u32 key_count;
+    u32 table_size;
+    u32 bucket_count;
+
+    u16* pilots;  // [bucket_count]
+    u32* remap;   // [table_size - key_count]
+    u32* slots;   // [key_count] entry index for every position
+};
+
+// MurmurHash3 finalizer.
+inline u32 Mix32(u32 x) {
+    x ^= x >> 16;
+    x *= 0x85EBCA6B;
+    x ^= x >> 13;
+    x *= 0xC2B2AE35;
+    x ^= x >> 16;
+    return x;
+}
+
+// Maps a 32-bit hash onto [0, range) without a division.
+inline u32 ReduceRange(u32 hash, u32 range) {
+    return (u32)(((u64)hash * range) >> 32);
+}
+
+inline void PerfectHashKey(u32 seed, const char* key, int length, u32* h0, u32* h1) {
+    *h0 = FNV1a_32(key, length, FNV32_OFFSET ^ seed);
+    *h1 = FNV1a_32(key, length, FNV32_OFFSET ^ Mix32(seed + 0x9E3779B9));
+}
+
+inline u32 PerfectHashPosition(u32 h0, u16 pilot, u32 table_size) {
+    return ReduceRange(Mix32(h0 ^ Mix32(pilot + 1)), table_size);
+}
+
+struct PerfectHashKeyInfo {
+    u32 h0;
+    u32 bucket;
+};
+
+// key_entries lists the entry of every unique key.
+internal bool TryBuildPerfectHash(CMU_PerfectHashIndex* index, const CMU_Entry* entries, const char* strings,
+                                  const u32* key_entries, PerfectHashKeyInfo* keys, u32* bucket_order, u32* bucket_starts, u32* bucket_keys,
+                                  u64* taken, u32* position_entries) {
+    u32 n = index->key_count;
+    u32 m = index->table_size;
+    u32 bucket_count = index->bucket_count;
+
+    // Hash every key and counting sort them into buckets.
+    ZeroArray(bucket_starts, bucket_count + 1);
+    for (u32 i = 0; i < n; i++) {
+        u32 h1;
+        const CMU_Entry* entry = &entries[key_entries[i]];
+        PerfectHashKey(index->seed, strings + entry->key_offset, entry->key_length, &keys[i].h0, &h1);
+        keys[i].bucket = ReduceRange(h1, bucket_count);
+        bucket_starts[keys[i].bucket + 1]++;
+    }
+
+    u32 max_bucket_size = 0;
+    for (u32 b = 0; b < bucket_count; b++) {
+        u32 size = bucket_starts[b + 1];
+        if (size > max_bucket_size) max_bucket_size = size;
+        bucket_starts[b + 1] += bucket_starts[b];
+    }
+
+    for (u32 b = 0; b < bucket_count; b++) {
+        bucket_order[b] = bucket_starts[b];
+    }
+    for (u32 i = 0; i < n; i++) {
+        bucket_keys[bucket_order[keys[i].bucket]++] = i;
+    }
+
+    // Place the largest buckets first while the table is still mostly empty.
+    u32 at = 0;
+    for (u32 size = max_bucket_size; size > 0; size--) {
+        for (u32 b = 0; b < bucket_count; b++) {
+            if (bucket_starts[b + 1] - bucket_starts[b] == size) {
+                bucket_order[at++] = b;
+            }
+        }
+    }
+    u32 used_buckets = at;
+
+    ZeroArray(taken, (m + 63) / 64);
+    ZeroArray(index->pilots, bucket_count);
+
+    u32 positions[64];
+    for (u32 i = 0; i < used_buckets; i++) {
+        u32 b = bucket_order[i];
+        u32 first = bucket_starts[b];
+        u32 size = bucket_starts[b + 1] - first;
+        if (size > countOf(positions)) {
+            return false;
+        }
+
+        bool placed = false;
+        for (u32 pilot = 0; pilot <= PERFECT_HASH_MAX_PILOT && !placed; pilot++) {
+            placed = true;
+            for (u32 k = 0; k < size && placed; k++) {
+                u32 position = PerfectHashPosition(keys[bucket_keys[first + k]].h0, (u16)pilot, m);
+                if (taken[position >> 6] & (1ull << (position & 63))) {
+                    placed = false;
+                }
+                for (u32 j = 0; j < k && placed; j++) {
+                    if (positions[j] == position) placed = false;
+                }
+                positions[k] = position;
+            }
+
+            if (placed) {
+                index->pilots[b] = (u16)pilot;
+                for (u32 k = 0; k < size; k++) {
+                    taken[positions[k] >> 6] |= 1ull << (positions[k] & 63);
+                    position_entries[positions[k]] = key_entries[bucket_keys[first + k]];
+                }
+            }
+        }
+
+        if (!placed) {
+            return false;
+        }
+    }
+
+    // Fold the positions past n into the free slots below n.
+    u32 free_slot = 0;
+    for (u32 position = n; position < m; position++) {
+        u32 entry = position_entries[position];
+        if (taken[position >> 6] & (1ull << (position & 63))) {
+            while (taken[free_slot >> 6] & (1ull << (free_slot & 63))) {
+                free_slot++;
+            }
+            index->remap[position - n] = free_slot;
+            index->slots[free_slot] = entry;
+            free_slot++;
+        } else {
+            index->remap[position - n] = 0;
+        }
+    }
+
+    for (u32 position = 0; position < n; position++) {
+        if (taken[position >> 6] & (1ull << (position & 63))) {
+            index->slots[position] = position_entries[position];
+        }
+    }
+
+    return true;
+}
+
+// Writes the entry of every unique key (the first one for duplicates) to key_entries in file order
+// and returns how many there are. order and scratch must hold entry_count indices.
+internal u32 CollectUniqueKeys(const CMU_Entry* entries, int entry_count, const char* strings,
+                               u32* order, u32* scratch, u32* key_entries) {
+    SortEntriesByKey(order, scratch, entries, entry_count, strings);
+
+    // The sort is stable, so the first entry of every run of equal keys is the earliest one.
+    u8* keep = (u8*)scratch;
+    ZeroArray(keep, entry_count);
+    for (int i = 0; i < entry_count; i++) {
+        const CMU_Entry* entry = &entries[order[i]];
+        const CMU_Entry* previous = i > 0 ? &entries[order[i - 1]] : 0;
+        if (!previous || !StringEquals(strings + entry->key_offset, entry->key_length,
+                                       strings + previous->key_offset, previous->key_length)) {
+            keep[order[i]] = 1;
+        }
+    }
+
+    u32 count = 0;
+    for (int i = 0; i < entry_count; i++) {
+        if (keep[i]) {
+            key_entries[count++] = (u32)i;
+        }
+    }
+    return count;
+}
+
+// The index arrays come from allocator, everything only needed while building from scratch.
+bool BuildPerfectHashIndex(CMU_PerfectHashIndex* index, const CMU_Entry* entries, int entry_count, const char* strings,
+                           Allocator allocator, Allocator scratch) {
+    ZeroStruct(index);
+    if (entry_count <= 0) {
+        return false;
+    }
+
+    u32* key_entries = ALLOC_ARRAY(scratch, u32, entry_count);
+    u32* order       = ALLOC_ARRAY(scratch, u32, entry_count);
+    u32* sort_scratch = ALLOC_ARRAY(scratch, u32, entry_count);
+    if (!key_entries || !order || !sort_scratch) {
+        if (scratch.free) {
+            scratch.free(scratch.context, key_entries);
+            scratch.free(scratch.context, order);
+            scratch.free(scratch.context, sort_scratch);
+        }
+        return false;
+    }
+    u32 n = CollectUniqueKeys(entries, entry_count, strings, order, sort_scratch, key_entries);
+    if (scratch.free) {
+        scratch.free(scratch.context, order);
+        scratch.free(scratch.context, sort_scratch);
+    }
+
+    index->key_count = n;
+    index->table_size = (u32)(n / PERFECT_HASH_LOAD_FACTOR) + 1;
+    index->bucket_count = (n + PERFECT_HASH_KEYS_PER_BUCKET - 1) / PERFECT_HASH_KEYS_PER_BUCKET;
+
+    u32 m = index->table_size;
+    index->pilots = ALLOC_ARRAY(allocator, u16, index->bucket_count);
+    index->remap  = ALLOC_ARRAY(allocator, u32, m - n);
+    index->slots  = ALLOC_ARRAY(allocator, u32, n);
+
+    PerfectHashKeyInfo* keys = ALLOC_ARRAY(scratch, PerfectHashKeyInfo, n);
+    u32* bucket_order  = ALLOC_ARRAY(scratch, u32, index->bucket_count);
+    u32* bucket_starts = ALLOC_ARRAY(scratch, u32, index->bucket_count + 1);
+    u32* bucket_keys   = ALLOC_ARRAY(scratch, u32, n);
+    u64* taken         = ALLOC_ARRAY(scratch, u64, (m + 63) / 64);
+    u32* position_entries = ALLOC_ARRAY(scratch, u32, m);
+
+    bool success = index->pilots && index->remap && index->slots && keys && bucket_order &&
+                   bucket_starts && bucket_keys && taken && position_entries;
+
+    if (success) {
+        success = false;
+        for (u32 attempt = 0; attempt < PERFECT_HASH_MAX_ATTEMPTS && !success; attempt++) {
+            index->seed = Mix32(attempt + 1);
+            success = TryBuildPerfectHash(index, entries, strings, key_entries, keys, bucket_order, bucket_starts, bucket_keys, taken, position_entries);
+        }
+    }
+
+    if (scratch.free) {
+        scratch.free(scratch.context, key_entries);
+        scratch.free(scratch.context, keys);
+        scratch.free(scratch.context, bucket_order);
+        scratch.free(scratch.context, bucket_starts);
+        scratch.free(scratch.context, bucket_keys);
+        scratch.free(scratch.context, taken);
+        scratch.free(scratch.context, position_entries);
+    }
+    if (!success && allocator.free) {
+        allocator.free(allocator.context, index->pilots);
+        allocator.free(allocator.context, index->remap);
+        allocator.free(allocator.context, index->slots);
+    }
+
+    if (!success) {
+        ZeroStruct(index);
+    }
+    return success;
+}
+
+// Returns the entry index for key or -1 if it isn't in the index.
+int FindInPerfectHashIndex(const CMU_PerfectHashIndex* index, const CMU_Entry* entries, const char* strings, const char* key, int length) {
+    u32 h0, h1;
+    PerfectHashKey(index->seed, key, length, &h0, &h1);
+
+    u16 pilot = index->pilots[ReduceRange(h1, index->bucket_count)];
+    u32 position = PerfectHashPosition(h0, pilot, index->table_size);
+    if (position >= index->key_count) {
+        position = index->remap[position - index->key_count];
+    }
+
+    u32 entry_index = index->slots[position];
+    const CMU_Entry* entry = &entries[entry_index];
+    if (StringEquals(key, length, strings + entry->key_offset, entry->key_length)) {
+        return (int)entry_index;
+    }
+    return -1;
+}
+
+#endif // _CMU_PERFECT_HASH_H_
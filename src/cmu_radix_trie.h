@@ -0,0 +1,373 @@
+#ifndef _CMU_RADIX_TRIE_H_
+#define _CMU_RADIX_TRIE_H_
+
+// Compressed radix trie over CMU_Entry keys.
+// Included by cmu_dictionary.h after CMU_Entry and SortEntriesByKey are defined.
+//
+// Every node stores the edge label leading into it as a slice of one of the keys below it, so the
+// trie never copies key bytes. Nodes live in one flat array and the children of a node are
+// contiguous. The first byte of each node's label is mirrored in edge_chars, so picking a child
+// is a scan over a few contiguous bytes instead of over the nodes themselves.
+// A look-up walks at most one node per label, which is O(word length) however many words share
+// the same prefix.
+
+#define TRIE_NO_ENTRY -1
+
+struct CMU_TrieNode {
+    u32 label_offset;  // offset into CMU_Dictionary::strings
+    u16 label_length;
+    u16 child_count;
+    u32 first_child;   // index into nodes
+    s32 entry;         // entry that ends at this node or TRIE_NO_ENTRY
+};
+
+struct CMU_RadixTrie {
+    u32 node_count;
+    CMU_TrieNode* nodes;  // nodes[0] is the root and has an empty label.
+    char* edge_chars;     // first byte of every node's label
+};
+
+struct TrieBuilder {
+    CMU_RadixTrie* trie;
+    const CMU_Entry* entries;
+    const char* strings;
+    const u32* order;
+};
+
+internal inline const char* TrieBuilderKey(TrieBuilder* builder, u32 i) {
+    return builder->strings + builder->entries[builder->order[i]].key_offset;
+}
+
+internal inline int TrieBuilderKeyLength(TrieBuilder* builder, u32 i) {
+    return builder->entries[builder->order[i]].key_length;
+}
+
+// Sets the label of the node for keys order[lo..hi), which share their first depth + 1 bytes,
+// to the rest of their common prefix. Returns the length of that prefix.
+internal int InitTrieChild(TrieBuilder* builder, u32 node_index, u32 lo, u32 hi, int depth) {
+    // The group is sorted, so its common prefix is the common prefix of its first and last key.
+    const char* first = TrieBuilderKey(builder, lo);
+    const char* last = TrieBuilderKey(builder, hi - 1);
+    int limit = TrieBuilderKeyLength(builder, lo);
+    if (TrieBuilderKeyLength(builder, hi - 1) < limit) {
+        limit = TrieBuilderKeyLength(builder, hi - 1);
+    }
+    int prefix = depth + 1;
+    while (prefix < limit && first[prefix] == last[prefix]) {
+        prefix++;
+    }
+
+    CMU_RadixTrie* trie = builder->trie;
+    CMU_TrieNode* node = &trie->nodes[node_index];
+    node->label_offset = builder->entries[builder->order[lo]].key_offset + depth;
+    node->label_length = (u16)(prefix - depth);
+    trie->edge_chars[node_index] = first[depth];
+    return prefix;
+}
+
+// Fills in node for keys order[lo..hi), which all share their first depth bytes.
+internal void BuildTrieNode(TrieBuilder* builder, u32 node_index, u32 lo, u32 hi, int depth) {
+    CMU_RadixTrie* trie = builder->trie;
+    CMU_TrieNode* node = &trie->nodes[node_index];
+    node->entry = TRIE_NO_ENTRY;
+    node->child_count = 0;
+    node->first_child = trie->node_count;
+
+    // Keys are sorted so a key ending here comes first. Duplicates keep the earliest entry.
+    while (lo < hi && TrieBuilderKeyLength(builder, lo) == depth) {
+        if (node->entry == TRIE_NO_ENTRY) {
+            node->entry = (s32)builder->order[lo];
+        }
+        lo++;
+    }
+
+    // Reserve one contiguous node per distinct next byte.
+    for (u32 i = lo; i < hi; ) {
+        char c = TrieBuilderKey(builder, i)[depth];
+        u32 end = i + 1;
+        while (end < hi && TrieBuilderKey(builder, end)[depth] == c) {
+            end++;
+        }
+        node->child_count++;
+        trie->node_count++;
+        i = end;
+    }
+
+    u32 child_index = node->first_child;
+    for (u32 i = lo; i < hi; child_index++) {
+        char c = TrieBuilderKey(builder, i)[depth];
+        u32 end = i + 1;
+        while (end < hi && TrieBuilderKey(builder, end)[depth] == c) {
+            end++;
+        }
+
+        int prefix = InitTrieChild(builder, child_index, i, end, depth);
+        BuildTrieNode(builder, child_index, i, end, prefix);
+        i = end;
+    }
+}
+
+// The subtrees below the root's children (one per first letter) are independent, so the parallel
+// build hands each worker a run of first letters. A worker sorts its slice of the entries and
+// builds its subtrees into its own node array: its group roots first, then everything below them.
+// The arrays are then stitched behind the shared root with their indices shifted.
+struct TrieSubtreeWork {
+    TrieBuilder builder;
+    CMU_RadixTrie local;
+    Allocator allocator;
+    u32* scratch;
+
+    u32 first_group;
+    u32 group_count;
+    const u32* group_starts;  // [group_count + 1] ranges of order
+    bool success;
+};
+
+internal void BuildTrieSubtrees(void* data) {
+    TrieSubtreeWork* work = (TrieSubtreeWork*)data;
+    CMU_RadixTrie* local = &work->local;
+    const u32* starts = work->group_starts + work->first_group;
+    u32 lo = starts[0];
+    u32 hi = starts[work->group_count];
+
+    u32 max_nodes = 2 * (hi - lo) + work->group_count;
+    local->nodes      = ALLOC_ARRAY(work->allocator, CMU_TrieNode, max_nodes);
+    local->edge_chars = ALLOC_ARRAY(work->allocator, char, max_nodes);
+    work->success = local->nodes && local->edge_chars;
+    if (!work->success) {
+        return;
+    }
+
+    work->builder.trie = local;
+    local->node_count = work->group_count;
+    for (u32 g = 0; g < work->group_count; g++) {
+        u32 group_lo = starts[g];
+        u32 group_hi = starts[g + 1];
+        SortEntryOrder((u32*)work->builder.order + group_lo, work->scratch + group_lo, group_hi - group_lo,
+                       work->builder.entries, work->builder.strings);
+
+        int prefix = InitTrieChild(&work->builder, g, group_lo, group_hi, 0);
+        BuildTrieNode(&work->builder, g, group_lo, group_hi, prefix);
+    }
+}
+
+internal bool BuildRadixTrieParallel(CMU_RadixTrie* trie, const CMU_Entry* entries, int entry_count, const char* strings,
+                                     u32* order, u32* scratch, Allocator allocator, Allocator scratch_allocator, u32 thread_count) {
+    // Bucket by first byte; empty keys go in front so they end at the root. Counting sort keeps
+    // file order inside a bucket, so duplicates still resolve to the earliest entry.
+    u32 bucket_starts[258] = {};
+    for (int i = 0; i < entry_count; i++) {
+        const CMU_Entry* entry = &entries[i];
+        u32 bucket = entry->key_length ? (u8)strings[entry->key_offset] + 1 : 0;
+        bucket_starts[bucket + 1]++;
+    }
+    for (u32 b = 0; b < 257; b++) {
+        bucket_starts[b + 1] += bucket_starts[b];
+    }
+
+    u32 bucket_at[257];
+    CopyArray(bucket_at, bucket_starts, 257);
+    for (int i = 0; i < entry_count; i++) {
+        const CMU_Entry* entry = &entries[i];
+        u32 bucket = entry->key_length ? (u8)strings[entry->key_offset] + 1 : 0;
+        order[bucket_at[bucket]++] = (u32)i;
+    }
+
+    u32 group_starts[257];
+    u32 group_count = 0;
+    for (u32 b = 1; b < 257; b++) {
+        if (bucket_starts[b + 1] > bucket_starts[b]) {
+            group_starts[group_count++] = bucket_starts[b];
+        }
+    }
+    group_starts[group_count] = (u32)entry_count;
+
+    // Hand out runs of groups with roughly equal entry counts.
+    const u32 MAX_TRIE_WORKERS = 64;
+    TrieSubtreeWork work[MAX_TRIE_WORKERS];
+    if (thread_count > MAX_TRIE_WORKERS) thread_count = MAX_TRIE_WORKERS;
+    if (thread_count > group_count) thread_count = group_count ? group_count : 1;
+
+    u32 worker_count = 0;
+    u32 group = 0;
+    while (group < group_count) {
+        u32 remaining_workers = thread_count - worker_count;
+        u32 target = (entry_count - group_starts[group]) / remaining_workers;
+        u32 first = group;
+        group++;
+        while (group < group_count && remaining_workers > 1 && group_starts[group] - group_starts[first] < target) {
+            group++;
+        }
+        if (remaining_workers == 1) {
+            group = group_count;
+        }
+
+        TrieSubtreeWork* w = &work[worker_count++];
+        ZeroStruct(w);
+        w->builder.entries = entries;
+        w->builder.strings = strings;
+        w->builder.order = order;
+        w->allocator = scratch_allocator;
+        w->scratch = scratch;
+        w->first_group = first;
+        w->group_count = group - first;
+        w->group_starts = group_starts;
+    }
+
+    RunInParallel(BuildTrieSubtrees, work, sizeof(TrieSubtreeWork), worker_count);
+
+    bool success = true;
+    u32 node_count = 1;
+    for (u32 i = 0; i < worker_count; i++) {
+        success = success && work[i].success;
+        node_count += work[i].local.node_count;
+    }
+
+    if (success) {
+        trie->nodes      = ALLOC_ARRAY(allocator, CMU_TrieNode, node_count);
+        trie->edge_chars = ALLOC_ARRAY(allocator, char, node_count);
+        success = trie->nodes && trie->edge_chars;
+    }
+
+    if (success) {
+        CMU_TrieNode* root = &trie->nodes[0];
+        root->label_offset = 0;
+        root->label_length = 0;
+        root->child_count = (u16)group_count;
+        root->first_child = 1;
+        root->entry = bucket_starts[1] > 0 ? (s32)order[0] : TRIE_NO_ENTRY;
+        trie->edge_chars[0] = 0;
+
+        // Global layout: root, every group root in letter order, then each worker's inner nodes.
+        u32 inner_base = 1 + group_count;
+        for (u32 i = 0; i < worker_count; i++) {
+            TrieSubtreeWork* w = &work[i];
+            u32 roots = w->group_count;
+            for (u32 n = 0; n < w->local.node_count; n++) {
+                u32 global_index = n < roots ? 1 + w->first_group + n : inner_base + (n - roots);
+                CMU_TrieNode node = w->local.nodes[n];
+                node.first_child = inner_base + (node.first_child - roots);
+                trie->nodes[global_index] = node;
+                trie->edge_chars[global_index] = w->local.edge_chars[n];
+            }
+            inner_base += w->local.node_count - roots;
+        }
+        trie->node_count = node_count;
+    }
+
+    if (scratch_allocator.free) {
+        for (u32 i = 0; i < worker_count; i++) {
+            scratch_allocator.free(scratch_allocator.context, work[i].local.nodes);
+            scratch_allocator.free(scratch_allocator.context, work[i].local.edge_chars);
+        }
+    }
+    return success;
+}
+
+// thread_count > 1 builds the subtrees of the root's children in parallel. Only the finished
+// nodes come from allocator; the sort order and the oversized build arrays come from scratch, so
+// a long-lived arena doesn't keep them.
+bool BuildRadixTrie(CMU_RadixTrie* trie, const CMU_Entry* entries, int entry_count, const char* strings,
+                    Allocator allocator, Allocator scratch_allocator, u32 thread_count = 1) {
+    ZeroStruct(trie);
+
+    u32* order   = ALLOC_ARRAY(scratch_allocator, u32, entry_count);
+    u32* scratch = ALLOC_ARRAY(scratch_allocator, u32, entry_count);
+    bool success = order && scratch;
+
+    if (success && thread_count > 1) {
+        success = BuildRadixTrieParallel(trie, entries, entry_count, strings, order, scratch, allocator, scratch_allocator, thread_count);
+    } else if (success) {
+        // A radix trie over n keys has at most 2n nodes plus the root.
+        u32 max_nodes = 2 * (u32)entry_count + 1;
+        CMU_RadixTrie build = {};
+        build.nodes      = ALLOC_ARRAY(scratch_allocator, CMU_TrieNode, max_nodes);
+        build.edge_chars = ALLOC_ARRAY(scratch_allocator, char, max_nodes);
+        success = build.nodes && build.edge_chars;
+        
+        if (success) {
+            SortEntriesByKey(order, scratch, entries, entry_count, strings);
+
+            TrieBuilder builder = {};
+            builder.trie = &build;
+            builder.entries = entries;
+            builder.strings = strings;
+            builder.order = order;
+
+            CMU_TrieNode* root = &build.nodes[0];
+            root->label_offset = 0;
+            root->label_length = 0;
+            build.edge_chars[0] = 0;
+            build.node_count = 1;
+            BuildTrieNode(&builder, 0, 0, (u32)entry_count, 0);
+
+            // Keep only the nodes that were used.
+            trie->nodes      = ALLOC_ARRAY(allocator, CMU_TrieNode, build.node_count);
+            trie->edge_chars = ALLOC_ARRAY(allocator, char, build.node_count);
+            success = trie->nodes && trie->edge_chars;
+            if (success) {
+                CopyArray(trie->nodes, build.nodes, build.node_count);
+                CopyArray(trie->edge_chars, build.edge_chars, build.node_count);
+                trie->node_count = build.node_count;
+            }
+        }
+
+        if (scratch_allocator.free) {
+            scratch_allocator.free(scratch_allocator.context, build.nodes);
+            scratch_allocator.free(scratch_allocator.context, build.edge_chars);
+        }
+    }
+
+    if (scratch_allocator.free) {
+        scratch_allocator.free(scratch_allocator.context, order);
+        scratch_allocator.free(scratch_allocator.context, scratch);
+    }
+    if (!success && allocator.free) {
+        allocator.free(allocator.context, trie->nodes);
+        allocator.free(allocator.context, trie->edge_chars);
+    }
+
+    if (!success) {
+        ZeroStruct(trie);
+    }
+    return success;
+}
+
+// Returns the entry index for key or -1 if it isn't in the trie.
+int FindInRadixTrie(const CMU_RadixTrie* trie, const char* strings, const char* key, int length) {
+    u32 node_index = 0;
+    int at = 0;
+
+    for (;;) {
+        const CMU_TrieNode* node = &trie->nodes[node_index];
+        if (at == length) {
+            return node->entry;
+        }
+
+        const char* chars = trie->edge_chars + node->first_child;
+        u32 child = 0;
+        while (child < node->child_count && chars[child] != key[at]) {
+            child++;
+        }
+        if (child == node->child_count) {
+            return -1;
+        }
+
+        node_index = node->first_child + child;
+        const CMU_TrieNode* next = &trie->nodes[node_index];
+        if (length - at < next->label_length) {
+            return -1;
+        }
+
+        // The first byte already matched through edge_chars.
+        const char* label = strings + next->label_offset;
+        for (int i = 1; i < next->label_length; i++) {
+            if (label[i] != key[at + i]) {
+                return -1;
+            }
+        }
+        at += next->label_length;
+    }
+}
+
+#endif // _CMU_RADIX_TRIE_H_
@@ -0,0 +1,76 @@
+#include "cmu_dictionary_image.h"
+#include "alien_speech_data.h"
+#include "unit_bank.h"
+
+// Offline asset compiler. Converts source assets into images the runtime can map directly.
+//
+//     alien_voice_compiler --dict data/cmudict/cmudict.dict data/cmudict/cmudict.bin [--keep-text]
+//     alien_voice_compiler --bank data/audio/units.bank
+
+void PrintUsage(const char* exe) {
+    printf("Usage: %s --dict <cmudict.dict> <output.bin> [--keep-text]\n", exe);
+    printf("       %s --bank <output.bank>\n", exe);
+}
+
+// The pronunciation text is left out unless keep_text; the image has the packed phones.
+int CompileDictionary(const char* input, const char* output, bool keep_text) {
+    CMU_Dictionary dict = {};
+    if (!LoadDictionary(input, &dict, HeapAllocator, GetProcessorCount())) {
+        return 1;
+    }
+
+    // Store the final unit ids so the runtime never maps phones to units itself.
+    if (!PrecompileDictionaryUnits(&dict, PhonesToUnits, HeapAllocator)) {
+        fprintf(stderr, "Out of memory while translating %s.\n", input);
+        return 1;
+    }
+
+    if (!SaveDictionaryImage(&dict, output, input, HeapAllocator, keep_text)) {
+        return 1;
+    }
+
+    printf("Wrote %d entries to %s\n", dict.entry_count, output);
+    return 0;
+}
+
+// Decodes every unit in UnitAssetPaths at the playback format and writes them as one bank.
+int CompileUnitBank(const char* output) {
+    const ma_uint32 channels = 1;
+    const ma_uint32 sample_rate = 48000;
+
+    UnitClip clips[Unit_Count] = {};
+    for (int i = 0; i < Unit_Count; i++) {
+        if (!LoadClipF32(&clips[i], UnitAssetPaths[i], channels, sample_rate)) {
+            return 1;
+        }
+    }
+
+    if (!SaveUnitBank(output, clips, channels, sample_rate)) {
+        return 1;
+    }
+
+    printf("Wrote %d units to %s\n", Unit_Count, output);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "--dict") == 0 && argc == 4) {
+        return CompileDictionary(argv[2], argv[3], false);
+    }
+
+    if (strcmp(argv[1], "--dict") == 0 && argc == 5 && strcmp(argv[4], "--keep-text") == 0) {
+        return CompileDictionary(argv[2], argv[3], true);
+    }
+
+    if (strcmp(argv[1], "--bank") == 0 && argc == 3) {
+        return CompileUnitBank(argv[2]);
+    }
+
+    PrintUsage(argv[0]);
+    return 1;
+}
@@ -8,14 +8,24 @@
 #include "string_utility.h"
 
 /* PLATFORM SPECIFIC */
+#if defined(_WIN32)
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include "windows.h"
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
 #ifdef _WIN64
     typedef void* FileHandle;
 #elif defined(_WIN32)
     typedef void* FileHandle;
-#elif defined(__linux__)
-    typedef int FileHandle;
 #else
-    #error "Unsupported platform"
+    typedef int FileHandle;
 #endif
 
 #if defined(_WIN32)
@@ -40,7 +50,9 @@ struct File {
     FileHandle handle;
     FileMode mode;
     u32 bufferPosition;
+    u32 bufferSize;
     u8* writeBuffer;
+    bool ownsBuffer;
 };
 
 void MyCreateDirectory(const char* directory);
@@ -50,11 +62,150 @@ bool GetAppDataFolder(char* directory);
 void GetAssetDirectory(String* directory);
 
 bool RemoveFile(const char* file);
-File FileOpen(const char* filePath, FileMode mode);
+File FileOpen(const char* filePath, FileMode mode, u8* writeBuffer = 0, u32 writeBufferSize = 0);
 void FileClose(File& file);
 u64 FileWrite(File& file, void* buffer, u64 size);
+bool FileFlush(File& file);
+bool FileIsOpen(File& file);
 //TODO(roger): Add FileRead API and remove the rest of fopen in codebase.
 
+#if defined(_WIN32)
+    #define INVALID_FILE_HANDLE INVALID_HANDLE_VALUE
+#else
+    #define INVALID_FILE_HANDLE -1
+#endif
+
+bool FileIsOpen(File& file) {
+    return file.handle != INVALID_FILE_HANDLE;
+}
+
+// Writes straight to the OS handle until everything is written or an error occurs.
+internal u64 FileWriteUnbuffered(File& file, const u8* buffer, u64 size) {
+    u64 written = 0;
+    while (written < size) {
+        u64 remaining = size - written;
+#if defined(_WIN32)
+        DWORD chunk = remaining > 0x40000000 ? 0x40000000 : (DWORD)remaining;
+        DWORD result = 0;
+        if (!WriteFile(file.handle, buffer + written, chunk, &result, 0) || result == 0) {
+            break;
+        }
+#else
+        size_t chunk = remaining > 0x40000000 ? 0x40000000 : (size_t)remaining;
+        ssize_t result = write(file.handle, buffer + written, chunk);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            break;
+        }
+#endif
+        written += (u64)result;
+    }
+    return written;
+}
+
+// Write modes buffer up to WriteBufferSize bytes, or into writeBuffer when the caller passes its
+// own (it is not freed, so workers can reuse one buffer for many files). Check the result with
+// FileIsOpen.
+File FileOpen(const char* filePath, FileMode mode, u8* writeBuffer, u32 writeBufferSize) {
+    File file = {};
+    file.mode = mode;
+
+#if defined(_WIN32)
+    DWORD access = GENERIC_READ;
+    DWORD creation = OPEN_EXISTING;
+    if (mode == FileMode_Write) {
+        access = GENERIC_WRITE;
+        creation = CREATE_ALWAYS;
+    } else if (mode == FileMode_WriteRead) {
+        access = GENERIC_READ | GENERIC_WRITE;
+        creation = CREATE_ALWAYS;
+    }
+    file.handle = CreateFileA(filePath, access, FILE_SHARE_READ, 0, creation, FILE_ATTRIBUTE_NORMAL, 0);
+#else
+    int flags = O_RDONLY;
+    if (mode == FileMode_Write) {
+        flags = O_WRONLY | O_CREAT | O_TRUNC;
+    } else if (mode == FileMode_WriteRead) {
+        flags = O_RDWR | O_CREAT | O_TRUNC;
+    }
+    file.handle = open(filePath, flags, 0644);
+#endif
+
+    if (file.handle == INVALID_FILE_HANDLE) {
+        return file;
+    }
+
+    if (mode != FileMode_Read && writeBuffer) {
+        file.writeBuffer = writeBuffer;
+        file.bufferSize = writeBufferSize;
+    } else if (mode != FileMode_Read) {
+        file.writeBuffer = (u8*)malloc(WriteBufferSize);
+        file.bufferSize = WriteBufferSize;
+        file.ownsBuffer = true;
+        if (file.writeBuffer == 0) {
+            FileClose(file);
+        }
+    }
+    return file;
+}
+
+bool FileFlush(File& file) {
+    if (file.bufferPosition == 0) {
+        return true;
+    }
+
+    u64 written = FileWriteUnbuffered(file, file.writeBuffer, file.bufferPosition);
+    bool success = written == file.bufferPosition;
+    file.bufferPosition = 0;
+    return success;
+}
+
+// Returns the bytes accepted, which is less than size only if the OS write failed.
+u64 FileWrite(File& file, void* buffer, u64 size) {
+    ASSERT_DEBUG(file.writeBuffer != 0, "File is not open for writing!");
+    const u8* bytes = (const u8*)buffer;
+
+    if (file.bufferPosition + size <= file.bufferSize) {
+        memcpy(file.writeBuffer + file.bufferPosition, bytes, (size_t)size);
+        file.bufferPosition += (u32)size;
+        return size;
+    }
+
+    if (!FileFlush(file)) {
+        return 0;
+    }
+
+    // Bigger than the buffer, no point in copying it first.
+    if (size > file.bufferSize) {
+        return FileWriteUnbuffered(file, bytes, size);
+    }
+
+    memcpy(file.writeBuffer, bytes, (size_t)size);
+    file.bufferPosition = (u32)size;
+    return size;
+}
+
+void FileClose(File& file) {
+    if (file.writeBuffer) {
+        FileFlush(file);
+        if (file.ownsBuffer) {
+            free(file.writeBuffer);
+        }
+        file.writeBuffer = 0;
+    }
+
+    if (file.handle != INVALID_FILE_HANDLE) {
+#if defined(_WIN32)
+        CloseHandle(file.handle);
+#else
+        close(file.handle);
+#endif
+    }
+    file.handle = INVALID_FILE_HANDLE;
+}
+
 struct MemoryBuffer {
     char* buffer;
     size_t size;
@@ -87,7 +238,7 @@ bool ReadEntireFileAndNullTerminate(const char* filePath, MemoryBuffer* outFile,
     long fileSize = ftell64(file);
     rewind(file);
 
-    char* buffer = (char*)allocator.alloc(fileSize + 1);
+    char* buffer = (char*)allocator.alloc(allocator.context, fileSize + 1);
     outFile->size = fileSize;
     if (buffer == 0) {
         fclose(file);
@@ -97,7 +248,7 @@ bool ReadEntireFileAndNullTerminate(const char* filePath, MemoryBuffer* outFile,
     size_t bytesRead = fread(buffer, 1, fileSize, file);
     if (bytesRead < fileSize) {
         if (allocator.free != 0) {
-            allocator.free(buffer);
+            allocator.free(allocator.context, buffer);
         }
         fclose(file);
         return false;
@@ -109,6 +260,97 @@ bool ReadEntireFileAndNullTerminate(const char* filePath, MemoryBuffer* outFile,
     return true;
 }
 
+// Read-only view of an entire file. The pages are shared between processes that map the same file.
+struct MappedFile {
+    u8* data;
+    size_t size;
+#if defined(_WIN32)
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+};
+
+bool MapFileReadOnly(const char* filePath, MappedFile* mapped) {
+    ZeroStruct(mapped);
+    
+#if defined(_WIN32)
+    mapped->file = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (mapped->file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(mapped->file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(mapped->file);
+        return false;
+    }
+    
+    mapped->mapping = CreateFileMappingA(mapped->file, 0, PAGE_READONLY, 0, 0, 0);
+    if (mapped->mapping == 0) {
+        CloseHandle(mapped->file);
+        return false;
+    }
+    
+    mapped->data = (u8*)MapViewOfFile(mapped->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (mapped->data == 0) {
+        CloseHandle(mapped->mapping);
+        CloseHandle(mapped->file);
+        return false;
+    }
+    mapped->size = (size_t)fileSize.QuadPart;
+#else
+    mapped->fd = open(filePath, O_RDONLY);
+    if (mapped->fd < 0) {
+        return false;
+    }
+    
+    struct stat st;
+    if (fstat(mapped->fd, &st) != 0 || st.st_size == 0) {
+        close(mapped->fd);
+        return false;
+    }
+    
+    void* data = mmap(0, (size_t)st.st_size, PROT_READ, MAP_SHARED, mapped->fd, 0);
+    if (data == MAP_FAILED) {
+        close(mapped->fd);
+        return false;
+    }
+    mapped->data = (u8*)data;
+    mapped->size = (size_t)st.st_size;
+#endif
+
+    return true;
+}
+
+void UnmapFile(MappedFile* mapped) {
+    if (mapped->data == 0) {
+        return;
+    }
+    
+#if defined(_WIN32)
+    UnmapViewOfFile(mapped->data);
+    CloseHandle(mapped->mapping);
+    CloseHandle(mapped->file);
+#else
+    munmap(mapped->data, mapped->size);
+    close(mapped->fd);
+#endif
+
+    ZeroStruct(mapped);
+}
+
+// Writes zeroes up to the next multiple of alignment (at most 4096) and advances *position.
+bool WritePadding(FILE* file, u64* position, u64 alignment) {
+    local_persist u8 zeroes[4096] = {};
+    ASSERT_DEBUG(alignment <= sizeof(zeroes), "Alignment is too large for WritePadding!");
+    u64 aligned = AlignUp(*position, alignment);
+    size_t padding = (size_t)(aligned - *position);
+    *position = aligned;
+    return fwrite(zeroes, 1, padding, file) == padding;
+}
+
 bool FileExists(const char* filePath) {
     FILE* f = fopen(filePath, "rb");
     if (f) {
@@ -118,4 +360,43 @@ bool FileExists(const char* filePath) {
     return false;
 }
 
+// Size and last write time of a file, enough to tell whether something built from it is stale.
+bool GetFileStamp(const char* filePath, u64* size, u64* modified) {
+#if defined(_WIN32)
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExA(filePath, GetFileExInfoStandard, &data)) {
+        return false;
+    }
+    *size = ((u64)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    *modified = ((u64)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+#else
+    struct stat info;
+    if (stat(filePath, &info) != 0) {
+        return false;
+    }
+    *size = (u64)info.st_size;
+    *modified = (u64)info.st_mtime;
+#endif
+    return true;
+}
+
+bool DirectoryExists(const char* directory) {
+#if defined(_WIN32)
+    DWORD attributes = GetFileAttributesA(directory);
+    return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+    struct stat info;
+    return stat(directory, &info) == 0 && S_ISDIR(info.st_mode);
+#endif
+}
+
+// Creates a single directory level. Does nothing if it already exists.
+void MyCreateDirectory(const char* directory) {
+#if defined(_WIN32)
+    CreateDirectoryA(directory, 0);
+#else
+    mkdir(directory, 0755);
+#endif
+}
+
 #endif //FILE_IO_H
\ No newline at end of file
@@ -1,45 +1,68 @@
 #include <stdio.h>
 #include <assert.h>
 
-#define WIN32_LEAN_AND_MEAN
-#include "windows.h"
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include "windows.h"
+#endif
 
 #include "file_io.h"
 #include "profiler_timer.h"
 #include "simple_tokenizer.h"
 #include "cmu_dictionary.h"
+#include "cmu_dictionary_image.h"
 #include "speech_audio.h"
 #include "alien_speech_data.h"
+#include "alien_translator.h"
+#include "unit_clip_loader.h"
+#include "render_stream.h"
+#include "memory_arena.h"
+#include "batch_translator.h"
+#include "speech_server.h"
 
-// This extracts the alpha chars like AA from AA0 and skips the 'stress' number. 
-// Examples of 'Phone' Tokens: B, Z, AA0, AA1, EH2, etc.
-ParsedToken NextPhoneToken(Tokenizer* tokenizer) {
-    ParsedToken token = ParseWhitespace(tokenizer);
-    if (token.type == ParsedTokenType_EndOfStream) {
-        return token;
-    }
-    
-    ParsedToken symbol = {};
-    symbol.text = tokenizer->at;
-    symbol.type = ParsedTokenType_Identifier;
-    
-    for (;;) {
-        if (tokenizer->at[0] == 0) {
-            break;
-        } else if (IsAlpha(tokenizer->at[0])) {
-            symbol.length++;
-        } else if (tokenizer->at[0] == ' ' || IsNumber(tokenizer->at[0])) {
-            tokenizer->at++;
-            break;
-        }
-        tokenizer->at++;
+#define DICTIONARY_ARENA_SLACK (16 * 1024 * 1024)
+
+struct TranslationOutput {
+    CMU_Dictionary* dict;
+    bool show_phones;
+    UnitBuffer units;
+};
+
+bool CollectUnits(void* data, TranslatedWord* word) {
+    TranslationOutput* output = (TranslationOutput*)data;
+    if (word->entry < 0) {
+        #ifdef _DEBUG
+            printf("Unable to find word in dictionary.\n");
+        #endif
+        return true;
     }
     
-    return symbol;
+    // Shown from the packed phones, images usually don't keep the text.
+    if (output->show_phones) {
+        CMU_Entry* entry = &output->dict->entries[word->entry];
+        char phones[4 * 256];
+        FormatPhones(EntryPhones(output->dict, entry), entry->phone_count, phones, sizeof(phones));
+        printf("%.*s: %s\n", word->length, word->text, phones);
+    }
+    
+    return AppendUnits(&output->units, word->units, word->unit_count);
+}
+
+// stderr, so it never mixes with server responses on stdout.
+void PrintProfileAtExit() {
+    PrintProfileReport(stderr);
+    StopProfiler();
 }
 
 int main(int argc, char** argv) {
     bool show_phones = false;
+    UnitClipLoadMode clip_load_mode = UnitClipLoad_Parallel;
+    bool use_transition_cache = false;
+    const char* out_filepath = 0;
+    WavSampleFormat out_format = WavSampleFormat_F32;
+    const char* batch_filepath = 0;
+    bool run_server = false;
+    u32 batch_threads = GetProcessorCount();
     const char* sentence = "Space exploration turns distant points of light into places with landscapes weather and history expanding our sense of what is possible By sending probes telescopes and people beyond Earth we learn how planets form how stars live and die and how our own world fits into a much larger story The same pursuit also drives practical breakthroughs from sharper imaging and safer materials to new ways of communicating while uniting people around a shared curiosity Most of all it invites a rare kind of perspective that our home is precious our knowledge is still young and the universe is vast enough to keep surprising us";
     
     int args_parsed = 1;
@@ -47,10 +70,32 @@ int main(int argc, char** argv) {
         if (argv[i][0] == '-' && argv[i][1] == '-') {
             const char* arg = &argv[i][2]; 
             if (strcmp(arg, "help") == 0) {
-                printf("Usage: %s [--show-phones] <message>\n", argv[0]);
+                printf("Usage: %s [--show-phones] [--lazy-clips] [--transition-cache] [--out file.wav [--s16]] [--profile] <message>\n", argv[0]);
+                printf("       %s --batch lines.txt --out directory [--threads n] [--s16] [--lazy-clips] [--transition-cache]\n", argv[0]);
+                printf("       %s --server [--lazy-clips] [--transition-cache]    (requests on stdin, see speech_server.h)\n", argv[0]);
                 return 0;
+            } else if (strcmp(arg, "profile") == 0) {
+                StartProfiler();
+                atexit(PrintProfileAtExit);
             } else if (strcmp(arg, "show-phones") == 0) {
                 show_phones = true;
+            } else if (strcmp(arg, "lazy-clips") == 0) {
+                clip_load_mode = UnitClipLoad_Lazy;
+            } else if (strcmp(arg, "transition-cache") == 0) {
+                use_transition_cache = true;
+            } else if (strcmp(arg, "out") == 0 && i + 1 < argc) {
+                out_filepath = argv[++i];
+                args_parsed++;
+            } else if (strcmp(arg, "batch") == 0 && i + 1 < argc) {
+                batch_filepath = argv[++i];
+                args_parsed++;
+            } else if (strcmp(arg, "threads") == 0 && i + 1 < argc) {
+                batch_threads = (u32)atoi(argv[++i]);
+                args_parsed++;
+            } else if (strcmp(arg, "server") == 0) {
+                run_server = true;
+            } else if (strcmp(arg, "s16") == 0) {
+                out_format = WavSampleFormat_S16;
             }
             args_parsed++;
         }
@@ -60,106 +105,184 @@ int main(int argc, char** argv) {
         sentence = argv[args_parsed];        
     }
 
+    // Prefer the pre-decoded bank (see compiler_main.cpp). Without it, the MP3s are either decoded
+    // in the background while the dictionary and audio engine load, or only once they are used.
+    const char* unit_bank_filepath = "data/audio/units.bank";
+    UnitClipSet unit_clips;
+    InitUnitClips(&unit_clips, 1, 48000);
+    if (!FileExists(unit_bank_filepath) || !LoadUnitClipsFromBank(&unit_clips, unit_bank_filepath)) {
+        if (clip_load_mode == UnitClipLoad_Parallel) {
+            u32 thread_count = GetProcessorCount() < 4 ? GetProcessorCount() : 4;
+            StartDecodingUnitClips(&unit_clips, thread_count);
+        }
+    }
+
+    // Prefer the precompiled image (see compiler_main.cpp) and fall back to parsing the text dictionary.
+    const char* dict_image_filepath = "data/cmudict/cmudict.bin";
     const char* dict_filepath = "data/cmudict/cmudict.dict";
+    // A parsed dictionary lives as long as the process, so it goes into one arena on huge pages
+    // when the OS allows, which keeps look-ups from missing the TLB all over the entries. Large
+    // pages on Windows are committed up front, so the arena is sized from the file: parsed cmudict
+    // takes about 3.3 times its text. A dictionary that doesn't fit is loaded again on the heap.
     CMU_Dictionary cmu_dict = {};
-    if (!LoadDictionary(dict_filepath, &cmu_dict, HeapAllocator)) {
+    Arena dict_arena = {};
+    Allocator dict_allocator = HeapAllocator;
+    if (!FileExists(dict_image_filepath) || !LoadDictionaryImage(dict_image_filepath, &cmu_dict, dict_filepath)) {
+        u64 dict_file_size = 0;
+        u64 dict_modified = 0;
+        if (GetFileStamp(dict_filepath, &dict_file_size, &dict_modified) &&
+            ReserveArena(&dict_arena, (size_t)(dict_file_size * 4) + DICTIONARY_ARENA_SLACK, ArenaFlag_HugePages)) {
+            dict_allocator = ArenaAllocator(&dict_arena);
+        }
+        bool loaded = LoadDictionary(dict_filepath, &cmu_dict, dict_allocator, GetProcessorCount()) &&
+                      PrecompileDictionaryUnits(&cmu_dict, PhonesToUnits, dict_allocator);
+        if (!loaded && dict_arena.base) {
+            fprintf(stderr, "The dictionary outgrew its arena, loading it on the heap.\n");
+            ReleaseArena(&dict_arena);
+            cmu_dict = {};
+            dict_allocator = HeapAllocator;
+            loaded = LoadDictionary(dict_filepath, &cmu_dict, dict_allocator, GetProcessorCount());
+        }
+        if (!loaded) {
+            return 1;
+        }
+    }
+    
+    // Images are compiled with units. A text dictionary gets them here, once, instead of per word.
+    if (!cmu_dict.has_units && !PrecompileDictionaryUnits(&cmu_dict, PhonesToUnits, dict_allocator)) {
+        fprintf(stderr, "Out of memory while translating the dictionary.\n");
         return 1;
     }
     
-    UnitClip unit_clips[Unit_Count];
-    for (int i = 0; i < countOf(UnitAssetPaths); i++) {
-        const char* path = UnitAssetPaths[i];
-        if (!LoadClipF32(&unit_clips[i], path, 1, 48000)) {
-            fprintf(stderr, "Failed to load audio file: %s\n", path);
+    ma_uint32 xfadeFrames = (ma_uint32)(0.1f * 48000);
+    if (batch_filepath) {
+        if (!out_filepath) {
+            fprintf(stderr, "--batch needs an --out directory.\n");
+            return 1;
+        }
+        
+        MemoryBuffer input = {};
+        if (!ReadEntireFileAndNullTerminate(batch_filepath, &input, HeapAllocator)) {
+            fprintf(stderr, "Failed to read %s.\n", batch_filepath);
+            return 1;
+        }
+        
+        size_t max_lines = 1;
+        for (size_t i = 0; i < input.size; i++) {
+            max_lines += input.buffer[i] == '\n';
         }
+        TextLine* lines = ALLOC_ARRAY(HeapAllocator, TextLine, max_lines);
+        if (!lines) {
+            fprintf(stderr, "Out of memory while reading %s.\n", batch_filepath);
+            return 1;
+        }
+        int line_count = SplitTextLines(input.buffer, input.size, lines);
+        
+        FinishDecodingUnitClips(&unit_clips);
+        TransitionCache transitions = {};
+        bool has_transitions = use_transition_cache && clip_load_mode != UnitClipLoad_Lazy &&
+                               UpdateTransitionCache(&transitions, unit_clips.clips, Unit_Count, 1, 48000, xfadeFrames);
+        
+        BatchSettings settings = {};
+        settings.out_directory = out_filepath;
+        settings.format = out_format;
+        settings.xfade_frames = xfadeFrames;
+        settings.transitions = has_transitions ? &transitions : 0;
+        
+        BatchStats stats;
+        if (!RunBatch(&cmu_dict, &unit_clips, lines, line_count, settings, batch_threads, &stats)) {
+            return 1;
+        }
+        PrintBatchStats(&stats, 48000);
+        return stats.lines_failed == 0 ? 0 : 1;
     }
     
+    if (run_server) {
+        FinishDecodingUnitClips(&unit_clips);
+        TransitionCache transitions = {};
+        bool has_transitions = use_transition_cache && clip_load_mode != UnitClipLoad_Lazy &&
+                               UpdateTransitionCache(&transitions, unit_clips.clips, Unit_Count, 1, 48000, xfadeFrames);
+        
+        SpeechServer server;
+        if (!InitSpeechServer(&server, &cmu_dict, &unit_clips, xfadeFrames, has_transitions ? &transitions : 0)) {
+            fprintf(stderr, "Failed to start the server.\n");
+            return 1;
+        }
+        RunSpeechServer(&server);
+        FreeSpeechServer(&server);
+        return 0;
+    }
+    
+    // Writing a file needs no audio device.
     ma_engine engine;
-    ma_result result = ma_engine_init(0, &engine);
-    assert(result == MA_SUCCESS);
+    if (!out_filepath) {
+        ma_result result = ma_engine_init(0, &engine);
+        assert(result == MA_SUCCESS);
+    }
     
-    Tokenizer tokenizer = {};
-    tokenizer.at = (char*)sentence;
+    TranslationContext translator = {};
+    if (!InitTranslationContext(&translator, &cmu_dict, HeapAllocator)) {
+        fprintf(stderr, "The dictionary has no unit translations.\n");
+        return 1;
+    }
     
-    const int MAX_STRING_BUFFER = 256;
-    char search_buffer[MAX_STRING_BUFFER];
+    TranslationOutput output = {};
+    output.dict = &cmu_dict;
+    output.show_phones = show_phones;
+    output.units.allocator = HeapAllocator;
     
-    const int MAX_OUTPUT_CLIPS = 512;
-    int output_length = 0;
-    UnitClip output[MAX_OUTPUT_CLIPS];
-        
-    ParsedToken token = NextToken(&tokenizer);
-    while (token.type != ParsedTokenType_EndOfStream) {
-        switch (token.type) {
-            case ParsedTokenType_Identifier: {            
-                assert(token.length < MAX_STRING_BUFFER);
-                memcpy(search_buffer, token.text, token.length);
-                search_buffer[token.length] = 0;
-                
-                ToLowerCase(search_buffer, token.length);
-                
-                char onset_consonant = 'X';
-                
-                ParsedToken phones = {};
-                if (GetPhones(&cmu_dict, search_buffer, &phones)) {
-                    char phones_buffer[MAX_STRING_BUFFER];
-                    memcpy(phones_buffer, phones.text, phones.length);
-                    phones_buffer[phones.length] = 0;
-                    
-                    if (show_phones) {
-                        printf("%s: %.*s\n", search_buffer, phones.length, phones.text);
-                    }
-                
-                    Tokenizer phones_tokenizer = {};
-                    phones_tokenizer.at = phones_buffer;
-                    
-                    for (;;) {
-                        ParsedToken symbol = NextPhoneToken(&phones_tokenizer);
-                        if (symbol.type == ParsedTokenType_EndOfStream) {
-                            break;
-                        }
-                        
-                        int index = 0;
-                        if (IsVowel(symbol, &index)) {
-                            bool found = false;
-                            
-                            for (int i = 0; i < countOf(UnitStrings); i++) {
-                                const char* unit_str = UnitStrings[i];
-                                if (unit_str[0] == onset_consonant && unit_str[1] == vowel_map[index].value[0]) {
-                                    assert(output_length < MAX_OUTPUT_CLIPS);
-                                    output[output_length++] = unit_clips[i];
-                                    found = true;
-                                    break;
-                                }
-                            }
-                            
-                            #ifdef _DEBUG
-                                if (!found) {
-                                    fprintf(stderr, "NOT FOUND: %c%c\n", onset_consonant, vowel_map[index].value[0]);
-                                }
-                            #endif
-                            
-                        } else if (IsConsonant(symbol, &index)) {
-                            onset_consonant = consonant_map[index].value[0];
-                        }
-                    }                    
-                } else {
-                    #ifdef _DEBUG
-                        printf("Unable to find word in dictionary.\n");
-                    #endif
-                }
-            } break;
+    UnitSink sink = {};
+    sink.proc = CollectUnits;
+    sink.data = &output;
+    
+    if (!TranslateText(&translator, sentence, CStringLength(sentence), sink)) {
+        fprintf(stderr, "Out of memory while translating.\n");
+        return 1;
+    }
+    
+    // Lazy mode only pays for the units this message speaks.
+    FinishDecodingUnitClips(&unit_clips);
+    PrepareUnitClips(&unit_clips, output.units.units, output.units.count);
+    
+    // Frames are synthesized as the device asks for them, so playback starts right away.
+    RenderStream stream;
+    if (!InitRenderStream(&stream, unit_clips.clips, output.units.units, 0, output.units.count, 1, 48000, xfadeFrames, HeapAllocator)) {
+        fprintf(stderr, "Out of memory while planning the render.\n");
+        return 1;
+    }
+    
+    // Pre-blended joins for every unit pair. Needs every clip, so it's skipped in lazy mode.
+    TransitionCache transitions = {};
+    if (use_transition_cache && clip_load_mode != UnitClipLoad_Lazy) {
+        if (UpdateTransitionCache(&transitions, unit_clips.clips, Unit_Count, 1, 48000, xfadeFrames)) {
+            stream.transitions = &transitions;
         }
-        
-        token = NextToken(&tokenizer);
     }
-        
-    ma_uint32 xfadeFrames = (ma_uint32)(0.1f * 48000);
-    RenderedAudio rendered_audio = RenderConcatenated(output, 0, output_length, 1, 48000, xfadeFrames);
-    PlayRendered(&engine, &rendered_audio);
     
-    double ms = (rendered_audio.frameCount * 1000.0) / (double)rendered_audio.sampleRate;
-    Sleep(ms);
+    // Offline mode: no audio device, and no waiting for the utterance to play out.
+    if (out_filepath) {
+        if (!WriteStreamToWav(&stream, out_filepath, out_format)) {
+            return 1;
+        }
+        printf("Wrote %llu frames (%.2f s) to %s.\n", (unsigned long long)stream.frame_count,
+               (double)stream.frame_count / (double)stream.sample_rate, out_filepath);
+        return 0;
+    }
+    
+    // Only starting playback is timed; the wait below is the length of the audio.
+    ma_sound sound;
+    bool playing = false;
+    {
+        PROFILE_ZONE("start playback");
+        playing = PlayStream(&engine, &stream, &sound);
+    }
+    if (!playing) {
+        fprintf(stderr, "Failed to start playback.\n");
+        return 1;
+    }
+    
+    double ms = (stream.frame_count * 1000.0) / (double)stream.sample_rate;
+    SleepMilliseconds((u32)ms);
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,254 @@
+#ifndef _MEMORY_ARENA_H_
+#define _MEMORY_ARENA_H_
+
+#include "utility.h"
+#include "threading.h"
+
+/* PLATFORM SPECIFIC */
+#if defined(_WIN32)
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include "windows.h"
+#else
+    #include <sys/mman.h>
+#endif
+
+// Bump allocators behind the Allocator interface.
+//
+// An arena hands out memory by moving an offset forward; free does nothing and everything
+// allocated after a mark is released at once by resetting to it. Two kinds share the same API:
+//     linear   - a fixed buffer the caller owns (InitLinearArena). Allocation fails once it's full.
+//     reserved - a range of address space (ReserveArena) committed as it fills up, optionally
+//                backed by huge pages. Committed pages are kept across resets, so a loop that
+//                resets every iteration stops touching the OS once it reached its peak.
+//
+// Every block is 16 byte aligned and remembers its size, so realloc can copy; growing the most
+// recent block happens in place. Arenas take a spin lock around every operation, which keeps them
+// safe to hand to the parallel dictionary loader; give every worker its own arena for scratch.
+
+#define ARENA_ALIGNMENT      16
+#define ARENA_COMMIT_SIZE    (64 * 1024)
+#define ARENA_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+enum ArenaFlags {
+    ArenaFlag_HugePages = 1,    // Best effort, silently falls back to normal pages.
+};
+
+struct Arena {
+    u8* base;
+    size_t capacity;
+    size_t committed;
+    size_t used;
+    size_t peak;
+    size_t last_block;  // Offset of the most recent block, for in-place realloc.
+    size_t commit_size;
+    bool reserved;      // Memory came from ReserveArena and is released by ReleaseArena.
+
+    volatile s32 lock;
+};
+
+typedef size_t ArenaMark;
+
+// Every block starts with its size, padded to the alignment.
+struct ArenaBlockHeader {
+    u64 size;
+    u64 reserved;
+};
+
+void InitLinearArena(Arena* arena, void* memory, size_t size) {
+    ZeroStruct(arena);
+    arena->base = (u8*)memory;
+    arena->capacity = size;
+    arena->committed = size;
+}
+
+// Reserves capacity bytes of address space. Nothing is committed until it is used.
+bool ReserveArena(Arena* arena, size_t capacity, u32 flags = 0) {
+    ZeroStruct(arena);
+    arena->commit_size = ARENA_COMMIT_SIZE;
+
+#if defined(_WIN32)
+    // Large pages need SeLockMemoryPrivilege and must be committed up front.
+    if (flags & ArenaFlag_HugePages) {
+        size_t large_page = GetLargePageMinimum();
+        if (large_page) {
+            size_t size = (size_t)AlignUp(capacity, large_page);
+            arena->base = (u8*)VirtualAlloc(0, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+            if (arena->base) {
+                arena->capacity = size;
+                arena->committed = size;
+            }
+        }
+    }
+    if (!arena->base) {
+        capacity = (size_t)AlignUp(capacity, ARENA_COMMIT_SIZE);
+        arena->base = (u8*)VirtualAlloc(0, capacity, MEM_RESERVE, PAGE_NOACCESS);
+        arena->capacity = capacity;
+    }
+#else
+    // Transparent huge pages only back 2 MB aligned ranges, so reserve extra to align the base.
+    bool huge_pages = (flags & ArenaFlag_HugePages) != 0;
+    size_t alignment = huge_pages ? ARENA_HUGE_PAGE_SIZE : ARENA_COMMIT_SIZE;
+    capacity = (size_t)AlignUp(capacity, alignment);
+    size_t reserve_size = capacity + (huge_pages ? alignment : 0);
+
+    void* reserve = mmap(0, reserve_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (reserve != MAP_FAILED) {
+        u8* base = (u8*)AlignUp((u64)reserve, alignment);
+        size_t head = (size_t)(base - (u8*)reserve);
+        if (head) {
+            munmap(reserve, head);
+        }
+        if (reserve_size - head > capacity) {
+            munmap(base + capacity, reserve_size - head - capacity);
+        }
+
+        arena->base = base;
+        arena->capacity = capacity;
+        if (huge_pages) {
+            madvise(base, capacity, MADV_HUGEPAGE);
+            arena->commit_size = ARENA_HUGE_PAGE_SIZE;
+        }
+    }
+#endif
+
+    arena->reserved = arena->base != 0;
+    return arena->reserved;
+}
+
+void ReleaseArena(Arena* arena) {
+    if (arena->reserved) {
+#if defined(_WIN32)
+        VirtualFree(arena->base, 0, MEM_RELEASE);
+#else
+        munmap(arena->base, arena->capacity);
+#endif
+    }
+    ZeroStruct(arena);
+}
+
+internal void LockArena(Arena* arena) {
+    while (!AtomicCompareExchange(&arena->lock, 0, 1)) {
+        YieldThread();
+    }
+}
+
+internal void UnlockArena(Arena* arena) {
+    AtomicStore(&arena->lock, 0);
+}
+
+internal bool CommitArena(Arena* arena, size_t size) {
+    if (size <= arena->committed) {
+        return true;
+    }
+    if (size > arena->capacity || !arena->reserved) {
+        return false;
+    }
+
+    size_t committed = (size_t)AlignUp(size, arena->commit_size);
+    if (committed > arena->capacity) {
+        committed = arena->capacity;
+    }
+
+#if defined(_WIN32)
+    bool success = VirtualAlloc(arena->base + arena->committed, committed - arena->committed, MEM_COMMIT, PAGE_READWRITE) != 0;
+#else
+    bool success = mprotect(arena->base + arena->committed, committed - arena->committed, PROT_READ | PROT_WRITE) == 0;
+#endif
+    if (success) {
+        arena->committed = committed;
+    }
+    return success;
+}
+
+// Expects the lock to be held.
+internal void* PushArenaBlock(Arena* arena, size_t size) {
+    size_t offset = (size_t)AlignUp(arena->used, ARENA_ALIGNMENT);
+    size_t end = offset + sizeof(ArenaBlockHeader) + (size_t)AlignUp(size, ARENA_ALIGNMENT);
+    if (end < offset || !CommitArena(arena, end)) {
+        return 0;
+    }
+
+    ArenaBlockHeader* header = (ArenaBlockHeader*)(arena->base + offset);
+    header->size = size;
+    arena->last_block = offset;
+    arena->used = end;
+    if (end > arena->peak) {
+        arena->peak = end;
+    }
+    return header + 1;
+}
+
+void* ArenaPush(Arena* arena, size_t size) {
+    LockArena(arena);
+    void* result = PushArenaBlock(arena, size);
+    UnlockArena(arena);
+    return result;
+}
+
+ArenaMark GetArenaMark(Arena* arena) {
+    LockArena(arena);
+    ArenaMark mark = arena->used;
+    UnlockArena(arena);
+    return mark;
+}
+
+// Releases everything allocated after the mark (everything for mark 0). Memory stays committed.
+void ResetArena(Arena* arena, ArenaMark mark = 0) {
+    LockArena(arena);
+    if (mark < arena->used) {
+        arena->used = mark;
+    }
+    arena->last_block = arena->used;
+    UnlockArena(arena);
+}
+
+internal void* ArenaAllocProc(void* context, size_t size) {
+    return ArenaPush((Arena*)context, size);
+}
+
+internal void* ArenaReallocProc(void* context, void* memory, size_t size) {
+    Arena* arena = (Arena*)context;
+    LockArena(arena);
+
+    void* result = 0;
+    if (!memory) {
+        result = PushArenaBlock(arena, size);
+    } else {
+        ArenaBlockHeader* header = (ArenaBlockHeader*)memory - 1;
+        size_t offset = (size_t)((u8*)header - arena->base);
+        size_t end = offset + sizeof(ArenaBlockHeader) + (size_t)AlignUp(size, ARENA_ALIGNMENT);
+
+        if (offset == arena->last_block && end >= offset && CommitArena(arena, end)) {
+            // The last block can simply grow (or shrink).
+            header->size = size;
+            arena->used = end;
+            if (end > arena->peak) {
+                arena->peak = end;
+            }
+            result = memory;
+        } else {
+            size_t old_size = (size_t)header->size;
+            result = PushArenaBlock(arena, size);
+            if (result) {
+                memcpy(result, memory, old_size < size ? old_size : size);
+            }
+        }
+    }
+
+    UnlockArena(arena);
+    return result;
+}
+
+// Allocations made through this are only released by ResetArena/ReleaseArena.
+Allocator ArenaAllocator(Arena* arena) {
+    Allocator allocator = {};
+    allocator.alloc = ArenaAllocProc;
+    allocator.realloc = ArenaReallocProc;
+    allocator.free = FreeStub;
+    allocator.context = arena;
+    return allocator;
+}
+
+#endif // _MEMORY_ARENA_H_
@@ -1,39 +1,385 @@
 #include "cmu_dictionary.h"
 #include "profiler_timer.h"
+#include "memory_arena.h"
+#include "bench_utility.h"
+
+// Look-up benchmark for every CMU_LookupEngine (and the linear scan as a baseline, skipped with
+// --linear-lookups 0).
+//
+// Every engine runs the same word streams:
+//     hit_uniform - dictionary words picked uniformly.
+//     hit_zipf    - dictionary words with Zipf (s = 1) frequencies, like running text.
+//     miss        - random letter strings that are not in the dictionary.
+// Each stream is looked up twice: once untimed per call for the mean, and once timing every call
+// for p50/p99 (which includes the cost of reading the clock). Results go to stdout as a table,
+// CSV or JSON so they can be compared across releases.
+
+enum BenchFormat {
+    BenchFormat_Table = 0,
+    BenchFormat_Csv,
+    BenchFormat_Json
+};
+
+enum {
+    Workload_HitUniform = 0,
+    Workload_HitZipf,
+    Workload_Miss,
+    Workload_Count
+};
+
+const char* WorkloadNames[Workload_Count] = {
+    "hit_uniform",
+    "hit_zipf",
+    "miss",
+};
+
+// Null terminated words, so the linear scan can use them too.
+struct WordStream {
+    char* text;
+    u32* offsets;
+    u16* lengths;
+    int count;
+};
+
+struct BenchResult {
+    const char* engine;
+    const char* workload;
+    int lookups;
+    int hits;
+    double mean_ns;
+    double p50_ns;
+    double p99_ns;
+    u64 index_bytes;
+    double build_ms;
+};
+
+internal bool InitWordStream(WordStream* stream, int count, int max_length) {
+    stream->text = ALLOC_ARRAY(HeapAllocator, char, (size_t)count * (max_length + 1));
+    stream->offsets = ALLOC_ARRAY(HeapAllocator, u32, count);
+    stream->lengths = ALLOC_ARRAY(HeapAllocator, u16, count);
+    stream->count = 0;
+    return stream->text && stream->offsets && stream->lengths;
+}
+
+internal void PushWord(WordStream* stream, u32* at, const char* word, int length) {
+    stream->offsets[stream->count] = *at;
+    stream->lengths[stream->count] = (u16)length;
+    memcpy(stream->text + *at, word, length);
+    stream->text[*at + length] = 0;
+    *at += length + 1;
+    stream->count++;
+}
+
+internal int LongestKey(CMU_Dictionary* dict) {
+    int longest = 0;
+    for (int i = 0; i < dict->entry_count; i++) {
+        if (dict->entries[i].key_length > longest) longest = dict->entries[i].key_length;
+    }
+    return longest;
+}
+
+internal bool BuildHitStream(WordStream* stream, CMU_Dictionary* dict, int count, bool zipf, u64 seed) {
+    if (!InitWordStream(stream, count, LongestKey(dict))) {
+        return false;
+    }
+
+    // Ranks map to a shuffled entry order, otherwise the frequent words would all start with 'a'.
+    int n = dict->entry_count;
+    u32* rank_entries = ALLOC_ARRAY(HeapAllocator, u32, n);
+    double* cdf = zipf ? ALLOC_ARRAY(HeapAllocator, double, n) : 0;
+    if (!rank_entries || (zipf && !cdf)) {
+        return false;
+    }
+
+    u64 state = seed;
+    for (int i = 0; i < n; i++) {
+        rank_entries[i] = i;
+    }
+    for (int i = n - 1; i > 0; i--) {
+        int j = (int)(NextRandom(&state) % (u64)(i + 1));
+        u32 swap = rank_entries[i];
+        rank_entries[i] = rank_entries[j];
+        rank_entries[j] = swap;
+    }
+
+    if (zipf) {
+        double sum = 0;
+        for (int i = 0; i < n; i++) {
+            sum += 1.0 / (i + 1);
+            cdf[i] = sum;
+        }
+        for (int i = 0; i < n; i++) {
+            cdf[i] /= sum;
+        }
+    }
+
+    u32 at = 0;
+    for (int i = 0; i < count; i++) {
+        int rank = 0;
+        if (zipf) {
+            double u = (NextRandom(&state) >> 11) * (1.0 / 9007199254740992.0);
+            int lo = 0;
+            int hi = n - 1;
+            while (lo < hi) {
+                int mid = (lo + hi) / 2;
+                if (cdf[mid] < u) lo = mid + 1; else hi = mid;
+            }
+            rank = lo;
+        } else {
+            rank = (int)(NextRandom(&state) % (u64)n);
+        }
+
+        CMU_Entry* entry = &dict->entries[rank_entries[rank]];
+        PushWord(stream, &at, EntryKey(dict, entry), entry->key_length);
+    }
+
+    free(rank_entries);
+    free(cdf);
+    return true;
+}
+
+internal bool BuildMissStream(WordStream* stream, CMU_Dictionary* dict, int count, u64 seed) {
+    const int max_length = 12;
+    if (!InitWordStream(stream, count, max_length)) {
+        return false;
+    }
+
+    u64 state = seed;
+    u32 at = 0;
+    char word[max_length];
+    while (stream->count < count) {
+        int length = 3 + (int)(NextRandom(&state) % (max_length - 2));
+        for (int i = 0; i < length; i++) {
+            word[i] = (char)('a' + NextRandom(&state) % 26);
+        }
+        if (FindEntry(dict, word, length) < 0) {
+            PushWord(stream, &at, word, length);
+        }
+    }
+    return true;
+}
+
+internal void FreeWordStream(WordStream* stream) {
+    free(stream->text);
+    free(stream->offsets);
+    free(stream->lengths);
+    ZeroStruct(stream);
+}
+
+internal int CompareDoubles(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+// engine < 0 runs the linear scan.
+internal bool LookupWord(CMU_Dictionary* dict, int engine, WordStream* stream, int i) {
+    const char* word = stream->text + stream->offsets[i];
+    if (engine < 0) {
+        ParsedToken phones;
+        return GetPhonesLinear(dict, word, &phones);
+    }
+    return FindEntry(dict, word, stream->lengths[i]) >= 0;
+}
+
+internal BenchResult RunWorkload(CMU_Dictionary* dict, int engine, WordStream* stream, int lookups,
+                                 double ticks_per_ms, double* samples) {
+    BenchResult result = {};
+    result.engine = engine < 0 ? "linear" : CMU_LookupEngineNames[engine];
+    result.lookups = lookups;
+
+    // Warm up the caches and the branch predictor on the same stream.
+    int warmup = lookups < 1000 ? lookups : 1000;
+    for (int i = 0; i < warmup; i++) {
+        LookupWord(dict, engine, stream, i);
+    }
+
+    Timer timer = StartTimer();
+    for (int i = 0; i < lookups; i++) {
+        result.hits += LookupWord(dict, engine, stream, i);
+    }
+    result.mean_ns = StopTimer(timer) * 1000000.0 / lookups;
+
+    // The hits are counted again so the compiler can't drop the timed calls.
+    double ns_per_tick = 1000000.0 / ticks_per_ms;
+    volatile int timed_hits = 0;
+    for (int i = 0; i < lookups; i++) {
+        u64 start = ReadProfilerTicks();
+        bool hit = LookupWord(dict, engine, stream, i);
+        u64 stop = ReadProfilerTicks();
+        timed_hits = timed_hits + hit;
+        samples[i] = (stop - start) * ns_per_tick;
+    }
+    qsort(samples, lookups, sizeof(double), CompareDoubles);
+    result.p50_ns = samples[(lookups - 1) / 2];
+    result.p99_ns = samples[((lookups - 1) * 99) / 100];
+    return result;
+}
+
+// Writes text as a JSON string literal, quotes included.
+internal void PrintJsonString(FILE* out, const char* text) {
+    fputc('"', out);
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(out, "\\%c", *c);
+        } else if ((u8)*c < 0x20) {
+            fprintf(out, "\\u%04x", (u8)*c);
+        } else {
+            fputc(*c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+internal void PrintResult(FILE* out, BenchFormat format, BenchResult* r, bool first) {
+    switch (format) {
+        case BenchFormat_Csv: {
+            if (first) {
+                fprintf(out, "engine,workload,lookups,hits,mean_ns,p50_ns,p99_ns,index_bytes,build_ms\n");
+            }
+            fprintf(out, "%s,%s,%d,%d,%.2f,%.2f,%.2f,%llu,%.3f\n", r->engine, r->workload, r->lookups, r->hits,
+                    r->mean_ns, r->p50_ns, r->p99_ns, (unsigned long long)r->index_bytes, r->build_ms);
+        } break;
+
+        case BenchFormat_Json: {
+            fprintf(out, "%s    {\"engine\": \"%s\", \"workload\": \"%s\", \"lookups\": %d, \"hits\": %d, "
+                         "\"mean_ns\": %.2f, \"p50_ns\": %.2f, \"p99_ns\": %.2f, \"index_bytes\": %llu, \"build_ms\": %.3f}",
+                    first ? "" : ",\n", r->engine, r->workload, r->lookups, r->hits,
+                    r->mean_ns, r->p50_ns, r->p99_ns, (unsigned long long)r->index_bytes, r->build_ms);
+        } break;
+
+        default: {
+            if (first) {
+                fprintf(out, "%-13s %-12s %9s %9s %10s %10s %10s %12s %10s\n",
+                        "engine", "workload", "lookups", "hits", "mean ns", "p50 ns", "p99 ns", "index bytes", "build ms");
+            }
+            fprintf(out, "%-13s %-12s %9d %9d %10.1f %10.1f %10.1f %12llu %10.3f\n", r->engine, r->workload, r->lookups, r->hits,
+                    r->mean_ns, r->p50_ns, r->p99_ns, (unsigned long long)r->index_bytes, r->build_ms);
+        } break;
+    }
+}
+
+// The trie is built while the dictionary loads, so time a second one in a throwaway arena. The
+// other indexes are timed as they are built for the run.
+internal double MeasureBuild(CMU_Dictionary* dict, CMU_LookupEngine engine) {
+    if (engine != CMU_Lookup_Trie) {
+        Timer timer = StartTimer();
+        bool built = BuildLookupIndex(dict, engine, HeapAllocator);
+        double ms = StopTimer(timer);
+        return built ? ms : -1.0;
+    }
+
+    Arena arena;
+    if (!ReserveArena(&arena, 1024ull * 1024 * 1024)) {
+        return -1.0;
+    }
+    CMU_RadixTrie trie;
+    Timer timer = StartTimer();
+    bool built = BuildRadixTrie(&trie, dict->entries, dict->entry_count, dict->strings, ArenaAllocator(&arena), ArenaAllocator(&arena));
+    double ms = StopTimer(timer);
+    ReleaseArena(&arena);
+    return built && BuildLookupIndex(dict, engine, HeapAllocator) ? ms : -1.0;
+}
 
 int main(int argc, char** argv) {
-    const char* dict_filepath = "data/cmudict.dict";
+    const char* dict_filepath = "data/cmudict/cmudict.dict";
+    int lookups = 200000;
+    int linear_lookups = 2000;
+    BenchFormat format = BenchFormat_Table;
+    const char* out_filepath = 0;
+    u64 seed = 0x9E3779B97F4A7C15ull;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--help") == 0) {
+            printf("Usage: %s [--dict path] [--lookups n] [--linear-lookups n] [--seed n] [--csv | --json] [--out file]\n", argv[0]);
+            return 0;
+        } else if (strcmp(argv[i], "--dict") == 0 && i + 1 < argc) {
+            dict_filepath = argv[++i];
+        } else if (strcmp(argv[i], "--lookups") == 0 && i + 1 < argc) {
+            lookups = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--linear-lookups") == 0 && i + 1 < argc) {
+            linear_lookups = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], 0, 10) | 1;
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_filepath = argv[++i];
+        } else if (strcmp(argv[i], "--csv") == 0) {
+            format = BenchFormat_Csv;
+        } else if (strcmp(argv[i], "--json") == 0) {
+            format = BenchFormat_Json;
+        }
+    }
+    if (lookups < 1) lookups = 1;
+    if (linear_lookups < 0) linear_lookups = 0;
+    if (linear_lookups > lookups) linear_lookups = lookups;
 
+    Timer load_timer = StartTimer();
     CMU_Dictionary cmu_dict = {};
     if (!LoadDictionary(dict_filepath, &cmu_dict, HeapAllocator)) {
         return 1;
     }
-    
-    // Show performance between Linear search and Clustered search.
-    // Use a word towards the end of the list to illustrate how slow a naive linear search is.
-    
-    int max_iterations = 10000;
-    const char* search = "zwicker";
-    
-    // Linear search
-    printf("\nRunning %d iterations for GetPhonesLinear...\n", max_iterations);
-    Timer timer = StartTimer();
-    ParsedToken phones = {};
-    for (int i = 0; i < max_iterations; i++) {
-        GetPhonesLinear(&cmu_dict, search, &phones);
+    double load_ms = StopTimer(load_timer);
+    u64 shared_bytes = (u64)cmu_dict.entry_count * sizeof(CMU_Entry) + cmu_dict.strings_size + cmu_dict.phones_size;
+
+    WordStream streams[Workload_Count] = {};
+    bool ready = BuildHitStream(&streams[Workload_HitUniform], &cmu_dict, lookups, false, seed) &&
+                 BuildHitStream(&streams[Workload_HitZipf], &cmu_dict, lookups, true, seed + 2) &&
+                 BuildMissStream(&streams[Workload_Miss], &cmu_dict, lookups, seed + 4);
+    double* samples = ALLOC_ARRAY(HeapAllocator, double, lookups);
+    if (!ready || !samples) {
+        fprintf(stderr, "Out of memory while generating the word streams.\n");
+        return 1;
     }
-    double ms = StopTimer(timer);
-    printf("    Result: %.*s\n", phones.length, phones.text);
-    printf("    Time: %f ms\n", ms);
-
-    // Clustered search
-    printf("\nRunning %d iterations for GetPhones (Clustered)...\n", max_iterations);
-    timer = StartTimer();
-    phones = {};
-    for (int i = 0; i < max_iterations; i++) {
-        GetPhones(&cmu_dict, search, &phones);
-    }
-    ms = StopTimer(timer);
-    printf("    Result: %.*s\n", phones.length, phones.text);
-    printf("    Time: %f ms\n", ms);
-}
\ No newline at end of file
+
+    double ticks_per_ms = MeasureProfilerTicksPerMs();
+    // --out writes the results to a file instead of stdout, for CSV and JSON consumers.
+    FILE* out = out_filepath ? fopen(out_filepath, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "Failed to open %s.\n", out_filepath);
+        return 1;
+    }
+    if (format == BenchFormat_Json) {
+        fprintf(out, "{\n  \"dictionary\": ");
+        PrintJsonString(out, dict_filepath);
+        fprintf(out, ",\n  \"entries\": %d,\n  \"load_ms\": %.3f,\n  \"shared_bytes\": %llu,\n  \"results\": [\n",
+                cmu_dict.entry_count, load_ms, (unsigned long long)shared_bytes);
+    } else if (format == BenchFormat_Table) {
+        fprintf(out, "\n%d entries from %s, loaded in %.3f ms. Entries, strings and phones: %llu bytes.\n\n",
+                cmu_dict.entry_count, dict_filepath, load_ms, (unsigned long long)shared_bytes);
+    }
+
+    bool first = true;
+    for (int engine = linear_lookups > 0 ? -1 : 0; engine < CMU_Lookup_Count; engine++) {
+        double build_ms = 0;
+        if (engine >= 0) {
+            build_ms = MeasureBuild(&cmu_dict, (CMU_LookupEngine)engine);
+            if (build_ms < 0) {
+                fprintf(stderr, "Failed to build the %s index.\n", CMU_LookupEngineNames[engine]);
+                continue;
+            }
+        }
+
+        for (int workload = 0; workload < Workload_Count; workload++) {
+            BenchResult result = RunWorkload(&cmu_dict, engine, &streams[workload], engine < 0 ? linear_lookups : lookups,
+                                             ticks_per_ms, samples);
+            result.workload = WorkloadNames[workload];
+            result.index_bytes = engine < 0 ? 0 : LookupIndexSize(&cmu_dict, (CMU_LookupEngine)engine);
+            result.build_ms = build_ms;
+            PrintResult(out, format, &result, first);
+            first = false;
+        }
+    }
+
+    if (format == BenchFormat_Json) {
+        fprintf(out, "\n  ]\n}\n");
+    }
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    for (int workload = 0; workload < Workload_Count; workload++) {
+        FreeWordStream(&streams[workload]);
+    }
+    HeapAllocator.free(HeapAllocator.context, samples);
+    return 0;
+}
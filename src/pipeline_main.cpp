@@ -0,0 +1,393 @@
+#include <stdio.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include "windows.h"
+#endif
+
+#include "file_io.h"
+#include "profiler_timer.h"
+#include "cmu_dictionary.h"
+#include "cmu_dictionary_image.h"
+#include "speech_audio.h"
+#include "alien_speech_data.h"
+#include "alien_translator.h"
+#include "unit_clip_loader.h"
+#include "memory_arena.h"
+#include "text_lines.h"
+#include "bench_utility.h"
+
+// End-to-end benchmark of the text to audio path, without an audio device.
+//
+// Every line of the corpus (a file, or random dictionary words) goes through the stages one after
+// the other, and each stage is timed on its own:
+//     tokenize        - split on whitespace and lower case every word.
+//     lookup          - find every word's entry (FindEntry) and its packed phones (EntryPhones).
+//     unit selection  - gather the dictionary's precompiled units into the utterance.
+//     render          - RenderConcatenated into memory.
+// Real-time factor is seconds of audio per second of wall time, for the whole pipeline and for
+// each stage on its own. Everything a line needs comes from a scratch arena that is reset after
+// the line, so the numbers don't include malloc.
+//
+// "phone mapping" (PhonesToUnits on every word) is informational. The live path does it once when
+// the dictionary loads, so it gets its own pass after the measured ones and stays out of the
+// total, the real-time factor and the per-line latency. Its row shows what it would add.
+
+enum PipelineStage {
+    Stage_Tokenize = 0,
+    Stage_Lookup,
+    Stage_PhoneMapping,
+    Stage_UnitSelection,
+    Stage_Render,
+    Stage_Count
+};
+
+const char* PipelineStageNames[Stage_Count] = {
+    "tokenize",
+    "lookup",
+    "phone mapping (info)",
+    "unit selection",
+    "render",
+};
+
+#define PIPELINE_SCRATCH_SIZE (1024 * 1024 * 1024)
+#define PIPELINE_WARMUP_LINES 100
+
+struct PipelineWord {
+    u32 offset;         // Into the lower case copy of the line.
+    u32 length;
+    const u8* phones;   // 0 if the word isn't in the dictionary.
+    int phone_count;
+    int entry;
+};
+
+struct PipelineStats {
+    u64 lines;
+    u64 words;
+    u64 missing_words;
+    u64 syllables;
+    u64 units;
+    u64 frames;
+    u64 stage_ticks[Stage_Count];
+};
+
+struct Pipeline {
+    CMU_Dictionary* dict;
+    UnitClipSet* clips;
+    const TransitionCache* transitions;
+    u32 xfade_frames;
+    Arena scratch;
+};
+
+// Runs one line through every stage, adding to stats. The phone mapping stage only runs with
+// map_phones and isn't part of the ticks the line took, which is what this returns.
+internal u64 RunPipelineLine(Pipeline* pipeline, const char* text, int length, PipelineStats* stats, bool map_phones) {
+    CMU_Dictionary* dict = pipeline->dict;
+    Allocator scratch = ArenaAllocator(&pipeline->scratch);
+    u64 ticks[Stage_Count + 1];
+
+    ticks[Stage_Tokenize] = ReadProfilerTicks();
+    char* lower = ALLOC_ARRAY(scratch, char, length + 1);
+    PipelineWord* words = ALLOC_ARRAY(scratch, PipelineWord, length / 2 + 1);
+    int word_count = 0;
+    int at = 0;
+    while (at < length) {
+        while (at < length && IsWhitespace(text[at])) {
+            at++;
+        }
+        int start = at;
+        while (at < length && !IsWhitespace(text[at])) {
+            at++;
+        }
+        if (at > start) {
+            memcpy(lower + start, text + start, at - start);
+            ToLowerCase(lower + start, at - start);
+            words[word_count].offset = start;
+            words[word_count].length = at - start;
+            word_count++;
+        }
+    }
+
+    ticks[Stage_Lookup] = ReadProfilerTicks();
+    int phone_count = 0;
+    for (int i = 0; i < word_count; i++) {
+        PipelineWord* word = &words[i];
+        word->entry = FindEntry(dict, lower + word->offset, word->length);
+        if (word->entry >= 0) {
+            CMU_Entry* entry = &dict->entries[word->entry];
+            word->phones = EntryPhones(dict, entry);
+            word->phone_count = entry->phone_count;
+            phone_count += entry->phone_count;
+        } else {
+            word->phones = 0;
+            word->phone_count = 0;
+            stats->missing_words++;
+        }
+    }
+
+    // Every syllable has one vowel, and every vowel becomes at most one unit.
+    ticks[Stage_PhoneMapping] = ReadProfilerTicks();
+    if (map_phones) {
+        u8* mapped = ALLOC_ARRAY(scratch, u8, phone_count + 1);
+        int mapped_count = 0;
+        for (int i = 0; i < word_count; i++) {
+            if (words[i].phones) {
+                mapped_count += PhonesToUnits(words[i].phones, words[i].phone_count, mapped + mapped_count);
+            }
+        }
+        stats->syllables += mapped_count;
+    }
+
+    ticks[Stage_UnitSelection] = ReadProfilerTicks();
+    UnitBuffer units = {};
+    units.allocator = scratch;
+    for (int i = 0; i < word_count; i++) {
+        if (words[i].entry >= 0) {
+            CMU_Entry* entry = &dict->entries[words[i].entry];
+            AppendUnits(&units, EntryUnits(dict, entry), entry->unit_count);
+        }
+    }
+
+    ticks[Stage_Render] = ReadProfilerTicks();
+    RenderedAudio audio = RenderConcatenated(pipeline->clips->clips, units.units, 0, units.count,
+                                             pipeline->clips->channels, pipeline->clips->sample_rate,
+                                             pipeline->xfade_frames, pipeline->transitions, scratch);
+    ticks[Stage_Count] = ReadProfilerTicks();
+
+    for (int i = 0; i < Stage_Count; i++) {
+        stats->stage_ticks[i] += ticks[i + 1] - ticks[i];
+    }
+    stats->lines++;
+    stats->words += word_count;
+    stats->units += units.count;
+    stats->frames += audio.frameCount;
+
+    ResetArena(&pipeline->scratch);
+    return ticks[Stage_Count] - ticks[Stage_Tokenize] - (ticks[Stage_UnitSelection] - ticks[Stage_PhoneMapping]);
+}
+
+// Sentences of 6 to 16 dictionary words, one per line. Only plain words are used (no variants like
+// "word(2)" or spelled out punctuation), and sentences start with a capital like real text.
+internal char* BuildSyntheticCorpus(CMU_Dictionary* dict, int word_count, u64 seed, size_t* size) {
+    u32* plain = ALLOC_ARRAY(HeapAllocator, u32, dict->entry_count);
+    int plain_count = 0;
+    size_t longest = 0;
+    for (int i = 0; i < dict->entry_count && plain; i++) {
+        CMU_Entry* entry = &dict->entries[i];
+        const char* key = EntryKey(dict, entry);
+        bool is_plain = entry->key_length > 0 && entry->unit_count > 0;
+        for (int c = 0; c < entry->key_length && is_plain; c++) {
+            is_plain = (key[c] >= 'a' && key[c] <= 'z') || key[c] == '\'';
+        }
+        if (is_plain) {
+            plain[plain_count++] = i;
+            if (entry->key_length > longest) longest = entry->key_length;
+        }
+    }
+
+    char* text = plain_count ? ALLOC_ARRAY(HeapAllocator, char, (size_t)word_count * (longest + 1) + 1) : 0;
+    if (!text) {
+        free(plain);
+        return 0;
+    }
+
+    u64 state = seed;
+    size_t at = 0;
+    int sentence_left = 0;
+    for (int i = 0; i < word_count; i++) {
+        bool first = sentence_left == 0;
+        if (first) {
+            sentence_left = 6 + (int)(NextRandom(&state) % 11);
+        }
+
+        CMU_Entry* entry = &dict->entries[plain[NextRandom(&state) % (u64)plain_count]];
+        memcpy(text + at, EntryKey(dict, entry), entry->key_length);
+        if (first && text[at] >= 'a' && text[at] <= 'z') {
+            text[at] -= 'a' - 'A';
+        }
+        at += entry->key_length;
+
+        sentence_left--;
+        text[at++] = sentence_left == 0 || i + 1 == word_count ? '\n' : ' ';
+    }
+    text[at] = 0;
+
+    free(plain);
+    *size = at;
+    return text;
+}
+
+int main(int argc, char** argv) {
+    const char* corpus_filepath = 0;
+    int synthetic_words = 200000;
+    int passes = 1;
+    bool use_transition_cache = false;
+    bool csv = false;
+    u64 seed = 0x9E3779B97F4A7C15ull;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--help") == 0) {
+            printf("Usage: %s [--corpus lines.txt | --words n] [--passes n] [--seed n] [--transition-cache] [--csv]\n", argv[0]);
+            return 0;
+        } else if (strcmp(argv[i], "--corpus") == 0 && i + 1 < argc) {
+            corpus_filepath = argv[++i];
+        } else if (strcmp(argv[i], "--words") == 0 && i + 1 < argc) {
+            synthetic_words = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--passes") == 0 && i + 1 < argc) {
+            passes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], 0, 10) | 1;
+        } else if (strcmp(argv[i], "--transition-cache") == 0) {
+            use_transition_cache = true;
+        } else if (strcmp(argv[i], "--csv") == 0) {
+            csv = true;
+        }
+    }
+    if (synthetic_words < 1) synthetic_words = 1;
+    if (passes < 1) passes = 1;
+
+    // Same data as the voice: the bank and the image when they were compiled, the sources otherwise.
+    const char* unit_bank_filepath = "data/audio/units.bank";
+    UnitClipSet unit_clips;
+    InitUnitClips(&unit_clips, 1, 48000);
+    if (!FileExists(unit_bank_filepath) || !LoadUnitClipsFromBank(&unit_clips, unit_bank_filepath)) {
+        StartDecodingUnitClips(&unit_clips, GetProcessorCount());
+    }
+
+    const char* dict_image_filepath = "data/cmudict/cmudict.bin";
+    const char* dict_filepath = "data/cmudict/cmudict.dict";
+    CMU_Dictionary cmu_dict = {};
+    if (!FileExists(dict_image_filepath) || !LoadDictionaryImage(dict_image_filepath, &cmu_dict, dict_filepath)) {
+        if (!LoadDictionary(dict_filepath, &cmu_dict, HeapAllocator, GetProcessorCount())) {
+            return 1;
+        }
+    }
+    if (!cmu_dict.has_units && !PrecompileDictionaryUnits(&cmu_dict, PhonesToUnits, HeapAllocator)) {
+        fprintf(stderr, "Out of memory while translating the dictionary.\n");
+        return 1;
+    }
+    FinishDecodingUnitClips(&unit_clips);
+
+    char* text = 0;
+    size_t text_size = 0;
+    if (corpus_filepath) {
+        MemoryBuffer input = {};
+        if (!ReadEntireFileAndNullTerminate(corpus_filepath, &input, HeapAllocator)) {
+            fprintf(stderr, "Failed to read %s.\n", corpus_filepath);
+            return 1;
+        }
+        text = input.buffer;
+        text_size = input.size;
+    } else {
+        text = BuildSyntheticCorpus(&cmu_dict, synthetic_words, seed, &text_size);
+        if (!text) {
+            fprintf(stderr, "Failed to build the synthetic corpus.\n");
+            return 1;
+        }
+    }
+
+    size_t max_lines = 1;
+    for (size_t i = 0; i < text_size; i++) {
+        max_lines += text[i] == '\n';
+    }
+    TextLine* lines = ALLOC_ARRAY(HeapAllocator, TextLine, max_lines);
+    u64* line_ticks = ALLOC_ARRAY(HeapAllocator, u64, max_lines * passes);
+    if (!lines || !line_ticks) {
+        fprintf(stderr, "Out of memory while splitting the corpus.\n");
+        return 1;
+    }
+    int line_count = SplitTextLines(text, text_size, lines);
+    if (line_count == 0) {
+        fprintf(stderr, "The corpus has no text.\n");
+        return 1;
+    }
+
+    u32 xfade_frames = (u32)(0.1f * 48000);
+    TransitionCache transitions = {};
+    bool has_transitions = use_transition_cache &&
+                           UpdateTransitionCache(&transitions, unit_clips.clips, Unit_Count, 1, 48000, xfade_frames);
+
+    Pipeline pipeline = {};
+    pipeline.dict = &cmu_dict;
+    pipeline.clips = &unit_clips;
+    pipeline.transitions = has_transitions ? &transitions : 0;
+    pipeline.xfade_frames = xfade_frames;
+    if (!ReserveArena(&pipeline.scratch, PIPELINE_SCRATCH_SIZE)) {
+        fprintf(stderr, "Failed to reserve the scratch arena.\n");
+        return 1;
+    }
+
+    // Warm up the caches and commit the scratch pages before anything is measured.
+    PipelineStats stats = {};
+    for (int i = 0; i < line_count && i < PIPELINE_WARMUP_LINES; i++) {
+        RunPipelineLine(&pipeline, lines[i].text, (int)lines[i].length, &stats, false);
+    }
+    stats = {};
+
+    double ticks_per_ms = MeasureProfilerTicksPerMs();
+    Timer timer = StartTimer();
+    u64 measured = 0;
+    for (int pass = 0; pass < passes; pass++) {
+        for (int i = 0; i < line_count; i++) {
+            line_ticks[measured++] = RunPipelineLine(&pipeline, lines[i].text, (int)lines[i].length, &stats, false);
+        }
+    }
+    double wall_seconds = StopTimer(timer) / 1000.0;
+
+    // One more pass, outside the timer, for the informational phone mapping stage. Scaled to as
+    // many passes as the others so its row compares with theirs.
+    PipelineStats mapping_stats = {};
+    for (int i = 0; i < line_count; i++) {
+        RunPipelineLine(&pipeline, lines[i].text, (int)lines[i].length, &mapping_stats, true);
+    }
+    stats.stage_ticks[Stage_PhoneMapping] = mapping_stats.stage_ticks[Stage_PhoneMapping] * passes;
+    stats.syllables = mapping_stats.syllables * passes;
+
+    qsort(line_ticks, measured, sizeof(u64), CompareTicks);
+    double ms_per_tick = 1.0 / ticks_per_ms;
+    double line_p50_ms = line_ticks[(measured - 1) / 2] * ms_per_tick;
+    double line_p99_ms = line_ticks[((measured - 1) * 99) / 100] * ms_per_tick;
+
+    u64 pipeline_ticks = 0;
+    for (int i = 0; i < Stage_Count; i++) {
+        if (i != Stage_PhoneMapping) {
+            pipeline_ticks += stats.stage_ticks[i];
+        }
+    }
+    double pipeline_seconds = pipeline_ticks * ms_per_tick / 1000.0;
+    double audio_seconds = (double)stats.frames / (double)unit_clips.sample_rate;
+
+    if (csv) {
+        printf("stage,ms,percent,ns_per_word,real_time_factor\n");
+    } else {
+        printf("\n%llu line(s), %llu words (%llu not in the dictionary), %llu syllables, %llu units%s\n",
+               (unsigned long long)stats.lines, (unsigned long long)stats.words, (unsigned long long)stats.missing_words,
+               (unsigned long long)stats.syllables, (unsigned long long)stats.units, has_transitions ? ", transition cache" : "");
+        printf("%.2f s of audio in %.3f s (%.3f s in the stages)\n", audio_seconds, wall_seconds, pipeline_seconds);
+        printf("    %.0f words/sec, %.0f syllables/sec, real-time factor %.1fx\n",
+               wall_seconds > 0 ? stats.words / wall_seconds : 0.0, wall_seconds > 0 ? stats.syllables / wall_seconds : 0.0,
+               wall_seconds > 0 ? audio_seconds / wall_seconds : 0.0);
+        printf("    per line: p50 %.3f ms, p99 %.3f ms\n\n", line_p50_ms, line_p99_ms);
+        printf("%-20s %12s %8s %12s %16s\n", "Stage", "ms", "%", "ns/word", "real-time factor");
+    }
+
+    // The measured stages, their total, and last the informational one.
+    int rows[Stage_Count + 1] = { Stage_Tokenize, Stage_Lookup, Stage_UnitSelection, Stage_Render, Stage_Count, Stage_PhoneMapping };
+    for (int row = 0; row <= Stage_Count; row++) {
+        int i = rows[row];
+        u64 ticks = i < Stage_Count ? stats.stage_ticks[i] : pipeline_ticks;
+        const char* name = i < Stage_Count ? PipelineStageNames[i] : "total";
+        double ms = ticks * ms_per_tick;
+        double percent = pipeline_ticks ? ticks * 100.0 / pipeline_ticks : 0.0;
+        double ns_per_word = stats.words ? ms * 1000000.0 / stats.words : 0.0;
+        double real_time_factor = ms > 0 ? audio_seconds * 1000.0 / ms : 0.0;
+        if (csv) {
+            printf("%s,%.3f,%.2f,%.2f,%.1f\n", name, ms, percent, ns_per_word, real_time_factor);
+        } else {
+            printf("%-20s %12.3f %7.1f%% %12.1f %15.1fx\n", name, ms, percent, ns_per_word, real_time_factor);
+        }
+    }
+
+    ReleaseArena(&pipeline.scratch);
+    return 0;
+}
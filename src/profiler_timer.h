@@ -1,11 +1,17 @@
 #ifndef _PROFILER_TIMER_H_
-#define _PROFILER_TIMER_H_ 
+#define _PROFILER_TIMER_H_
 
-// WINDOWS ONLY
+#include "utility.h"
+#include "threading.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #ifdef _WIN32
 
-#define WIN32_LEAN_AND_MEAN
+#ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+#endif
 #include "windows.h"
 
 struct Timer {
@@ -21,15 +27,331 @@ Timer StartTimer() {
 double StopTimer(Timer timer) {
     LARGE_INTEGER stop;
     QueryPerformanceCounter(&stop);
-    
+
     LARGE_INTEGER frequency;
     QueryPerformanceFrequency(&frequency);
-    
+
     LONGLONG elapsedParts = stop.QuadPart - timer.start.QuadPart;
-    double time = (elapsedParts * 1000.0f) / frequency.QuadPart; 
+    double time = (elapsedParts * 1000.0f) / frequency.QuadPart;
+    return time;
+}
+
+#else
+
+#include <time.h>
+
+struct Timer {
+    timespec start;
+};
+
+Timer StartTimer() {
+    Timer timer = {};
+    clock_gettime(CLOCK_MONOTONIC, &timer.start);
+    return timer;
+}
+
+double StopTimer(Timer timer) {
+    timespec stop;
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    double time = (stop.tv_sec - timer.start.tv_sec) * 1000.0 + (stop.tv_nsec - timer.start.tv_nsec) / 1000000.0;
     return time;
 }
 
 #endif
 
-#endif  //_PROFILER_TIMER_H_
\ No newline at end of file
+// Scoped zones: PROFILE_ZONE("name") times the rest of the enclosing scope. Zones nest, and every
+// thread records into its own event buffer (no locks, only the first zone on a thread registers
+// its buffer with a compare-exchange). Nothing is recorded until StartProfiler, so instrumented
+// code only pays for a branch; build with PROFILER_ENABLED=0 to remove the zones entirely.
+//
+// Ticks come from rdtsc on x86 and from the OS clock elsewhere, calibrated against Timer once in
+// StartProfiler. PrintProfileReport lists every zone with its call count, inclusive and exclusive
+// time (exclusive leaves out nested zones on the same thread), the share of the recording threads'
+// time spent exclusively in it, and p50/p99 of a single call. Buffers are only read by the report,
+// which should run once the zones it covers have ended; StopProfiler frees them.
+
+#ifndef PROFILER_ENABLED
+    #define PROFILER_ENABLED 1
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #include <intrin.h>
+    #define PROFILER_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define PROFILER_RDTSC 1
+#else
+    #define PROFILER_RDTSC 0
+#endif
+
+inline u64 ReadProfilerTicks() {
+#if PROFILER_RDTSC
+    return __rdtsc();
+#elif defined(_WIN32)
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (u64)counter.QuadPart;
+#else
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (u64)now.tv_sec * 1000000000ull + (u64)now.tv_nsec;
+#endif
+}
+
+#define PROFILER_MAX_DEPTH  64
+#define PROFILER_MAX_EVENTS (1 << 16)   // Per thread, later events are counted as dropped.
+#define PROFILER_MAX_ZONES  128
+
+struct ProfileEvent {
+    const char* name;
+    u64 start;
+    u64 ticks;
+    u64 exclusive_ticks;
+    u32 depth;
+};
+
+struct ProfilerThread {
+    ProfilerThread* next;
+    u32 depth;
+    u64 child_ticks[PROFILER_MAX_DEPTH];    // Time spent in zones nested at every depth.
+    volatile s32 event_count;
+    u32 dropped;
+    ProfileEvent events[PROFILER_MAX_EVENTS];
+};
+
+struct Profiler {
+    bool active;
+    u32 generation;     // Bumped by StopProfiler, so threads register a new buffer next time.
+    u64 start_ticks;
+    double ticks_per_ms;
+    void* volatile threads; // ProfilerThread list, pushed with a compare-exchange.
+};
+
+Profiler profiler;
+static thread_local ProfilerThread* profiler_thread;
+static thread_local u32 profiler_thread_generation;
+
+// Spins for about 10 ms to find how fast ReadProfilerTicks counts.
+double MeasureProfilerTicksPerMs() {
+    Timer timer = StartTimer();
+    u64 start = ReadProfilerTicks();
+    double ms = 0;
+    while ((ms = StopTimer(timer)) < 10.0) {
+    }
+    return (double)(ReadProfilerTicks() - start) / ms;
+}
+
+// Calibrates the clock and starts recording.
+void StartProfiler() {
+    profiler.ticks_per_ms = MeasureProfilerTicksPerMs();
+    profiler.start_ticks = ReadProfilerTicks();
+    profiler.active = true;
+}
+
+internal ProfilerThread* GetProfilerThread() {
+    if (!profiler_thread || profiler_thread_generation != profiler.generation) {
+        ProfilerThread* thread = (ProfilerThread*)calloc(1, sizeof(ProfilerThread));
+        if (!thread) {
+            return 0;
+        }
+
+        void* head;
+        do {
+            head = profiler.threads;
+            thread->next = (ProfilerThread*)head;
+        } while (!AtomicCompareExchangePointer(&profiler.threads, head, thread));
+        profiler_thread = thread;
+        profiler_thread_generation = profiler.generation;
+    }
+    return profiler_thread;
+}
+
+struct ProfileScope {
+    const char* name;
+    ProfilerThread* thread;
+    u64 start;
+
+    ProfileScope(const char* zone_name) {
+        thread = profiler.active ? GetProfilerThread() : 0;
+        if (!thread || thread->depth >= PROFILER_MAX_DEPTH) {
+            thread = 0;
+            return;
+        }
+
+        name = zone_name;
+        thread->child_ticks[thread->depth] = 0;
+        thread->depth++;
+        start = ReadProfilerTicks();
+    }
+
+    ~ProfileScope() {
+        if (!thread) {
+            return;
+        }
+
+        u64 ticks = ReadProfilerTicks() - start;
+        u32 depth = --thread->depth;
+        if (depth > 0) {
+            thread->child_ticks[depth - 1] += ticks;
+        }
+
+        s32 index = thread->event_count;
+        if (index < PROFILER_MAX_EVENTS) {
+            ProfileEvent* event = &thread->events[index];
+            event->name = name;
+            event->start = start;
+            event->ticks = ticks;
+            event->exclusive_ticks = ticks - thread->child_ticks[depth];
+            event->depth = depth;
+            AtomicStore(&thread->event_count, index + 1);
+        } else {
+            thread->dropped++;
+        }
+    }
+};
+
+#if PROFILER_ENABLED
+    #define PROFILE_CONCAT_(a, b) a##b
+    #define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+    #define PROFILE_ZONE(name) ProfileScope PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#else
+    #define PROFILE_ZONE(name)
+#endif
+
+struct ProfileZoneStats {
+    const char* name;
+    u64 first_start;
+    u32 min_depth;
+    u64 calls;
+    u64 ticks;
+    u64 exclusive_ticks;
+    u64* samples;
+    u64 sample_count;
+};
+
+internal int CompareTicks(const void* a, const void* b) {
+    u64 x = *(const u64*)a;
+    u64 y = *(const u64*)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+internal int CompareZoneStart(const void* a, const void* b) {
+    const ProfileZoneStats* x = (const ProfileZoneStats*)a;
+    const ProfileZoneStats* y = (const ProfileZoneStats*)b;
+    return x->first_start < y->first_start ? -1 : (x->first_start > y->first_start ? 1 : 0);
+}
+
+internal ProfileZoneStats* FindZoneStats(ProfileZoneStats* zones, int* zone_count, const char* name) {
+    for (int i = 0; i < *zone_count; i++) {
+        if (zones[i].name == name || strcmp(zones[i].name, name) == 0) {
+            return &zones[i];
+        }
+    }
+    if (*zone_count == PROFILER_MAX_ZONES) {
+        return 0;
+    }
+
+    ProfileZoneStats* zone = &zones[(*zone_count)++];
+    ZeroStruct(zone);
+    zone->name = name;
+    zone->first_start = ~0ull;
+    zone->min_depth = PROFILER_MAX_DEPTH;
+    return zone;
+}
+
+// Aggregates every thread's events by zone name. Zones are listed in the order they first
+// started, indented by how deep they were nested.
+void PrintProfileReport(FILE* out) {
+    if (!profiler.active) {
+        return;
+    }
+
+    ProfileZoneStats zones[PROFILER_MAX_ZONES];
+    int zone_count = 0;
+    u64 dropped = 0;
+
+    for (int pass = 0; pass < 2; pass++) {
+        for (ProfilerThread* thread = (ProfilerThread*)profiler.threads; thread; thread = thread->next) {
+            s32 event_count = AtomicLoad(&thread->event_count);
+            for (s32 i = 0; i < event_count; i++) {
+                ProfileEvent* event = &thread->events[i];
+                ProfileZoneStats* zone = FindZoneStats(zones, &zone_count, event->name);
+                if (!zone) {
+                    continue;
+                }
+
+                if (pass == 0) {
+                    zone->calls++;
+                    zone->ticks += event->ticks;
+                    zone->exclusive_ticks += event->exclusive_ticks;
+                    if (event->start < zone->first_start) zone->first_start = event->start;
+                    if (event->depth < zone->min_depth) zone->min_depth = event->depth;
+                } else if (zone->samples && zone->sample_count < zone->calls) {
+                    zone->samples[zone->sample_count++] = event->ticks;
+                }
+            }
+            if (pass == 0) {
+                dropped += thread->dropped;
+            }
+        }
+
+        if (pass == 0) {
+            for (int i = 0; i < zone_count; i++) {
+                zones[i].samples = (u64*)malloc(zones[i].calls * sizeof(u64));
+            }
+        }
+    }
+
+    qsort(zones, zone_count, sizeof(ProfileZoneStats), CompareZoneStart);
+
+    // Zones on several threads add up to more than the wall time, so shares are of wall time times
+    // the number of threads that recorded.
+    u32 thread_count = 0;
+    for (ProfilerThread* thread = (ProfilerThread*)profiler.threads; thread; thread = thread->next) {
+        thread_count++;
+    }
+
+    double ms_per_tick = 1.0 / profiler.ticks_per_ms;
+    double total_ms = (ReadProfilerTicks() - profiler.start_ticks) * ms_per_tick;
+    double thread_ms = total_ms * (thread_count ? thread_count : 1);
+    fprintf(out, "\n%-32s %10s %12s %12s %7s %11s %11s\n", "Zone", "Calls", "Incl ms", "Excl ms", "Excl %", "p50 us", "p99 us");
+    for (int i = 0; i < zone_count; i++) {
+        ProfileZoneStats* zone = &zones[i];
+        double p50 = 0;
+        double p99 = 0;
+        if (zone->samples && zone->sample_count > 0) {
+            qsort(zone->samples, zone->sample_count, sizeof(u64), CompareTicks);
+            p50 = zone->samples[(zone->sample_count - 1) / 2] * ms_per_tick * 1000.0;
+            p99 = zone->samples[((zone->sample_count - 1) * 99) / 100] * ms_per_tick * 1000.0;
+        }
+
+        int indent = (int)(zone->min_depth < 8 ? zone->min_depth : 8) * 2;
+        double exclusive_ms = zone->exclusive_ticks * ms_per_tick;
+        fprintf(out, "%*s%-*s %10llu %12.3f %12.3f %6.1f%% %11.3f %11.3f\n", indent, "", 32 - indent, zone->name,
+                (unsigned long long)zone->calls, zone->ticks * ms_per_tick, exclusive_ms,
+                thread_ms > 0 ? exclusive_ms * 100.0 / thread_ms : 0.0, p50, p99);
+        free(zone->samples);
+    }
+    fprintf(out, "%.3f ms since the profiler started on %u thread(s)", total_ms, thread_count);
+    if (dropped) {
+        fprintf(out, ", %llu event(s) dropped", (unsigned long long)dropped);
+    }
+    fprintf(out, "\n");
+}
+
+// Stops recording and frees every thread's buffer. Call it once no zone is open anywhere (e.g.
+// after the report at exit); StartProfiler can record again afterwards.
+void StopProfiler() {
+    profiler.active = false;
+    ProfilerThread* thread = (ProfilerThread*)profiler.threads;
+    profiler.threads = 0;
+    profiler.generation++;
+    while (thread) {
+        ProfilerThread* next = thread->next;
+        free(thread);
+        thread = next;
+    }
+}
+
+#endif  //_PROFILER_TIMER_H_
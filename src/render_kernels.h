@@ -0,0 +1,112 @@
+#ifndef _RENDER_KERNELS_H_
+#define _RENDER_KERNELS_H_
+
+#include "utility.h"
+
+// Inner loops of the renderer: scaled copies and linear crossfades over interleaved f32 frames.
+//
+// Mono (the format the units are decoded to) runs 8 (AVX2) or 4 (SSE2) samples at a time. The
+// fade weight of a lane is its frame index times a per-overlap step, so there is no division or
+// branch per sample. Other channel counts and builds without SSE2 use the scalar loops.
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define RENDER_SIMD_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+    #include <emmintrin.h>
+    #define RENDER_SIMD_WIDTH 4
+#else
+    #define RENDER_SIMD_WIDTH 0
+#endif
+
+// Weight step of a crossfade over frame_count frames. Matches the original ramp, which reaches 1.0
+// on the last overlapped frame.
+inline float CrossfadeStep(u64 frame_count) {
+    return 1.0f / (float)(frame_count > 1 ? frame_count - 1 : 1);
+}
+
+// dst[i] = src[i] * gain. A gain of 1 is a plain copy.
+void ScaleSamples(float* dst, const float* src, u64 sample_count, float gain) {
+    if (sample_count == 0) {
+        return;
+    }
+    if (gain == 1.0f) {
+        memcpy(dst, src, (size_t)sample_count * sizeof(float));
+        return;
+    }
+
+    u64 i = 0;
+#if RENDER_SIMD_WIDTH == 8
+    __m256 g = _mm256_set1_ps(gain);
+    for (; i + 8 <= sample_count; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(src + i), g));
+    }
+#elif RENDER_SIMD_WIDTH == 4
+    __m128 g = _mm_set1_ps(gain);
+    for (; i + 4 <= sample_count; i += 4) {
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(src + i), g));
+    }
+#endif
+    for (; i < sample_count; i++) {
+        dst[i] = src[i] * gain;
+    }
+}
+
+// Part of a crossfade over overlap_frames frames: frames [first_frame, first_frame + frame_count).
+// a and b point at the start of the overlap in both sources, dst at the first frame to write.
+// dst = a * gain_a * (1 - t) + b * gain_b * t, with t going from 0 to 1 over the whole overlap.
+void CrossfadeFrameRange(float* dst, const float* a, float gain_a, const float* b, float gain_b,
+                         u64 first_frame, u64 frame_count, u64 overlap_frames, u32 channels) {
+    float step = CrossfadeStep(overlap_frames);
+    a += first_frame * channels;
+    b += first_frame * channels;
+    u64 f = 0;
+
+    if (channels == 1) {
+#if RENDER_SIMD_WIDTH == 8
+        __m256 ga = _mm256_set1_ps(gain_a);
+        __m256 gb = _mm256_set1_ps(gain_b);
+        __m256 vstep = _mm256_set1_ps(step);
+        __m256 index = _mm256_add_ps(_mm256_set1_ps((float)first_frame), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7));
+        __m256 advance = _mm256_set1_ps(8.0f);
+        for (; f + 8 <= frame_count; f += 8) {
+            __m256 t = _mm256_mul_ps(index, vstep);
+            __m256 va = _mm256_mul_ps(_mm256_loadu_ps(a + f), ga);
+            __m256 vb = _mm256_mul_ps(_mm256_loadu_ps(b + f), gb);
+            _mm256_storeu_ps(dst + f, _mm256_add_ps(va, _mm256_mul_ps(_mm256_sub_ps(vb, va), t)));
+            index = _mm256_add_ps(index, advance);
+        }
+#elif RENDER_SIMD_WIDTH == 4
+        __m128 ga = _mm_set1_ps(gain_a);
+        __m128 gb = _mm_set1_ps(gain_b);
+        __m128 vstep = _mm_set1_ps(step);
+        __m128 index = _mm_add_ps(_mm_set1_ps((float)first_frame), _mm_setr_ps(0, 1, 2, 3));
+        __m128 advance = _mm_set1_ps(4.0f);
+        for (; f + 4 <= frame_count; f += 4) {
+            __m128 t = _mm_mul_ps(index, vstep);
+            __m128 va = _mm_mul_ps(_mm_loadu_ps(a + f), ga);
+            __m128 vb = _mm_mul_ps(_mm_loadu_ps(b + f), gb);
+            _mm_storeu_ps(dst + f, _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(vb, va), t)));
+            index = _mm_add_ps(index, advance);
+        }
+#endif
+    }
+
+    for (; f < frame_count; f++) {
+        float t = (float)(first_frame + f) * step;
+        for (u32 ch = 0; ch < channels; ch++) {
+            u64 i = f * channels + ch;
+            float va = a[i] * gain_a;
+            float vb = b[i] * gain_b;
+            dst[i] = va + (vb - va) * t;
+        }
+    }
+}
+
+// A whole crossfade over frame_count frames.
+inline void CrossfadeFrames(float* dst, const float* a, float gain_a, const float* b, float gain_b,
+                            u64 frame_count, u32 channels) {
+    CrossfadeFrameRange(dst, a, gain_a, b, gain_b, 0, frame_count, frame_count, channels);
+}
+
+#endif // _RENDER_KERNELS_H_
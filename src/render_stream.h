@@ -0,0 +1,251 @@
+#ifndef _RENDER_STREAM_H_
+#define _RENDER_STREAM_H_
+
+#include "speech_audio.h"
+#include "wav_writer.h"
+#include "profiler_timer.h"
+
+// Pull-based renderer. Instead of rendering the whole utterance up front (RenderConcatenated),
+// a RenderStream holds a small plan - the unit ids, where every clip starts in the output and how
+// much it overlaps the next one - and synthesizes frames when miniaudio asks for them. Playback
+// starts as soon as the plan is built, and reading frames never allocates.
+//
+// The output is identical to RenderConcatenated: every clip contributes
+//     [body][join]
+// where body is the part of the clip nobody overlaps and join is its tail crossfaded with the
+// head of the next clip.
+
+struct RenderStream {
+    ma_data_source_base base; // Must be first, miniaudio treats the stream as a ma_data_source.
+
+    const UnitClip* clip_table;
+    const TransitionCache* transitions; // Optional, set after InitRenderStream.
+    u32 channels;
+    u32 sample_rate;
+
+    int unit_count;
+    u8* units;
+    float* gains;             // Optional, one per unit.
+    u64* body_starts;         // Output frame where the body of every clip begins.
+    u32* overlaps;            // Overlap between clip i and i + 1 (0 for the last one).
+    u64 frame_count;
+
+    // Only touched by whoever reads the stream (the audio thread while playing).
+    u64 cursor;
+    int current;              // Clip that contains the cursor.
+};
+
+internal u64 StreamClipEnd(RenderStream* stream, int index) {
+    return index + 1 < stream->unit_count ? stream->body_starts[index + 1] : stream->frame_count;
+}
+
+// Writes (or with out = 0, skips) up to frame_count frames at the cursor. Returns the frames done.
+// No profile zone in here: this runs in the device callback, and the first zone on a thread
+// allocates its event buffer. Offline callers time it themselves.
+internal u64 ReadRenderStream(RenderStream* stream, float* out, u64 frame_count) {
+    u32 channels = stream->channels;
+    u64 done = 0;
+
+    while (done < frame_count && stream->cursor < stream->frame_count) {
+        while (stream->cursor >= StreamClipEnd(stream, stream->current)) {
+            stream->current++;
+        }
+
+        int i = stream->current;
+        const UnitClip* clip = &stream->clip_table[stream->units[i]];
+        float gain = stream->gains ? stream->gains[i] : 1.0f;
+        u64 overlap_in = i > 0 ? stream->overlaps[i - 1] : 0;
+        u64 overlap_out = stream->overlaps[i];
+        u64 body_frames = clip->frameCount - overlap_in - overlap_out;
+
+        u64 local = stream->cursor - stream->body_starts[i];
+        u64 count = 0;
+        if (local < body_frames) {
+            count = body_frames - local;
+            if (count > frame_count - done) count = frame_count - done;
+            if (out) {
+                ScaleSamples(out + done * channels, clip->pcm + (overlap_in + local) * channels, count * channels, gain);
+            }
+        } else {
+            u64 join_frame = local - body_frames;
+            count = overlap_out - join_frame;
+            if (count > frame_count - done) count = frame_count - done;
+            if (out) {
+                float next_gain = stream->gains ? stream->gains[i + 1] : 1.0f;
+                WriteJoinFrames(out + done * channels, stream->clip_table, stream->transitions,
+                                stream->units[i], gain, stream->units[i + 1], next_gain,
+                                join_frame, count, overlap_out, channels);
+            }
+        }
+
+        done += count;
+        stream->cursor += count;
+    }
+
+    return done;
+}
+
+internal ma_result RenderStreamOnRead(ma_data_source* data_source, void* frames_out, ma_uint64 frame_count, ma_uint64* frames_read) {
+    u64 done = ReadRenderStream((RenderStream*)data_source, (float*)frames_out, frame_count);
+    if (frames_read) {
+        *frames_read = done;
+    }
+    return (done == 0 && frame_count > 0) ? MA_AT_END : MA_SUCCESS;
+}
+
+internal ma_result RenderStreamOnSeek(ma_data_source* data_source, ma_uint64 frame_index) {
+    RenderStream* stream = (RenderStream*)data_source;
+    if (frame_index > stream->frame_count) {
+        return MA_INVALID_ARGS;
+    }
+
+    // Last clip whose body starts at or before the frame.
+    int lo = 0;
+    int hi = stream->unit_count > 0 ? stream->unit_count - 1 : 0;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (stream->body_starts[mid] <= frame_index) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    stream->current = lo;
+    stream->cursor = frame_index;
+    return MA_SUCCESS;
+}
+
+internal ma_result RenderStreamOnGetDataFormat(ma_data_source* data_source, ma_format* format, ma_uint32* channels,
+                                               ma_uint32* sample_rate, ma_channel* channel_map, size_t channel_map_cap) {
+    RenderStream* stream = (RenderStream*)data_source;
+    if (format) *format = ma_format_f32;
+    if (channels) *channels = stream->channels;
+    if (sample_rate) *sample_rate = stream->sample_rate;
+    if (channel_map) ma_channel_map_init_standard(ma_standard_channel_map_default, channel_map, channel_map_cap, stream->channels);
+    return MA_SUCCESS;
+}
+
+internal ma_result RenderStreamOnGetCursor(ma_data_source* data_source, ma_uint64* cursor) {
+    *cursor = ((RenderStream*)data_source)->cursor;
+    return MA_SUCCESS;
+}
+
+internal ma_result RenderStreamOnGetLength(ma_data_source* data_source, ma_uint64* length) {
+    *length = ((RenderStream*)data_source)->frame_count;
+    return MA_SUCCESS;
+}
+
+internal ma_data_source_vtable render_stream_vtable = {
+    RenderStreamOnRead,
+    RenderStreamOnSeek,
+    RenderStreamOnGetDataFormat,
+    RenderStreamOnGetCursor,
+    RenderStreamOnGetLength,
+    0, // onSetLooping
+    0  // flags
+};
+
+// Builds the plan for a unit id stream. units and gains (optional) are copied, so the caller can
+// reuse its buffers; the clips must stay loaded while the stream is read. The plan is the only
+// allocation: about 13 bytes per unit instead of the rendered frames.
+bool InitRenderStream(RenderStream* stream, const UnitClip* clip_table, const u8* units, const float* gains, int unit_count,
+                      u32 channels, u32 sample_rate, u32 xfade_frames, Allocator allocator) {
+    PROFILE_ZONE("plan render");
+    ZeroStruct(stream);
+    stream->clip_table = clip_table;
+    stream->channels = channels;
+    stream->sample_rate = sample_rate;
+    stream->unit_count = unit_count;
+
+    int count = unit_count > 0 ? unit_count : 1;
+    stream->units = ALLOC_ARRAY(allocator, u8, count);
+    stream->body_starts = ALLOC_ARRAY(allocator, u64, count);
+    stream->overlaps = ALLOC_ARRAY(allocator, u32, count);
+    stream->gains = gains ? ALLOC_ARRAY(allocator, float, count) : 0;
+    if (!stream->units || !stream->body_starts || !stream->overlaps || (gains && !stream->gains)) {
+        return false;
+    }
+
+    if (unit_count > 0) {
+        memcpy(stream->units, units, unit_count);
+    }
+    if (gains && unit_count > 0) {
+        memcpy(stream->gains, gains, unit_count * sizeof(float));
+    }
+
+    u64 position = 0;
+    u64 overlap_in = 0;
+    for (int i = 0; i < unit_count; i++) {
+        u64 frames = clip_table[units[i]].frameCount;
+        u64 overlap_out = 0;
+        if (i + 1 < unit_count) {
+            overlap_out = ClampOverlap(frames, overlap_in, clip_table[units[i + 1]].frameCount, xfade_frames);
+        }
+
+        stream->body_starts[i] = position;
+        stream->overlaps[i] = (u32)overlap_out;
+        position += frames - overlap_in;
+        overlap_in = overlap_out;
+    }
+    stream->overlaps[count - 1] = 0;
+    stream->frame_count = position;
+
+    ma_data_source_config config = ma_data_source_config_init();
+    config.vtable = &render_stream_vtable;
+    return ma_data_source_init(&config, &stream->base) == MA_SUCCESS;
+}
+
+void FreeRenderStream(RenderStream* stream, Allocator allocator) {
+    ma_data_source_uninit(&stream->base);
+    if (allocator.free) {
+        allocator.free(allocator.context, stream->units);
+        allocator.free(allocator.context, stream->body_starts);
+        allocator.free(allocator.context, stream->overlaps);
+        allocator.free(allocator.context, stream->gains);
+    }
+    ZeroStruct(stream);
+}
+
+// Starts playing the stream. sound must stay alive (and the stream readable) until playback ends.
+bool PlayStream(ma_engine* engine, RenderStream* stream, ma_sound* sound) {
+    if (ma_sound_init_from_data_source(engine, stream, 0, NULL, sound) != MA_SUCCESS) {
+        return false;
+    }
+
+    ma_sound_set_pitch(sound, 1.25f);
+    return ma_sound_start(sound) == MA_SUCCESS;
+}
+
+// Renders the whole stream into a WAV file, a chunk at a time, without an audio device. Reads from
+// the current cursor, so a fresh stream writes every frame.
+bool WriteStreamToWav(RenderStream* stream, const char* filePath, WavSampleFormat format,
+                      u8* write_buffer = 0, u32 write_buffer_size = 0) {
+    PROFILE_ZONE("write wav");
+    WavWriter writer;
+    if (!BeginWav(&writer, filePath, stream->frame_count - stream->cursor, stream->channels, stream->sample_rate, format,
+                  write_buffer, write_buffer_size)) {
+        return false;
+    }
+
+    float chunk[4096];
+    u64 chunk_frames = countOf(chunk) / stream->channels;
+    for (;;) {
+        u64 frames = 0;
+        {
+            PROFILE_ZONE("render");
+            frames = ReadRenderStream(stream, chunk, chunk_frames);
+        }
+        if (frames == 0 || !WriteWavFrames(&writer, chunk, frames)) {
+            break;
+        }
+    }
+
+    if (!EndWav(&writer)) {
+        fprintf(stderr, "Failed to write %s.\n", filePath);
+        return false;
+    }
+    return true;
+}
+
+#endif // _RENDER_STREAM_H_
@@ -1,5 +1,10 @@
+#ifndef _SPEECH_AUDIO_H_
+#define _SPEECH_AUDIO_H_
+
 #define MINIAUDIO_IMPLEMENTATION
 #include "miniaudio.h"
+#include "render_kernels.h"
+#include "profiler_timer.h"
 
 struct UnitClip {
     float*  pcm;           // interleaved f32
@@ -41,96 +46,163 @@ struct RenderedAudio {
     ma_uint32 sampleRate;
 };
 
+// Overlap between two neighbouring clips. The previous clip has already given prevOverlapIn of
+// its frames to the clip before it, so the overlaps on both sides of a clip never exceed its length.
+static inline ma_uint64 ClampOverlap(ma_uint64 prevFrames, ma_uint64 prevOverlapIn, ma_uint64 frames, ma_uint32 xfadeFrames) {
+    ma_uint64 overlap = xfadeFrames;
+    if (prevFrames - prevOverlapIn < overlap) overlap = prevFrames - prevOverlapIn;
+    if (frames < overlap) overlap = frames;
+    return overlap;
+}
+
+// Every possible join (the tail of clip a crossfaded into the head of clip b) blended ahead of time.
+// With a handful of units there are only unitCount^2 joins, so the renderers can copy them instead
+// of blending. Joins are only used when both gains are 1 and the overlap is the full xfadeFrames
+// (overlaps get shorter next to very short clips). Rebuild with UpdateTransitionCache whenever the
+// crossfade length or the output format changes; lookups with other parameters just miss.
+struct TransitionCache {
+    ma_uint32 unitCount;
+    ma_uint32 xfadeFrames;
+    ma_uint32 channels;
+    ma_uint32 sampleRate;
+    float* joins;          // [a * unitCount + b][xfadeFrames * channels]
+    ma_uint8* valid;       // [a * unitCount + b], 0 if a clip is shorter than the overlap
+};
+
+void FreeTransitionCache(TransitionCache* cache) {
+    if (cache->joins) ma_free(cache->joins, NULL);
+    if (cache->valid) ma_free(cache->valid, NULL);
+    memset(cache, 0, sizeof(*cache));
+}
+
+// Does nothing if the cache already matches the parameters.
+bool UpdateTransitionCache(TransitionCache* cache, const UnitClip* clipTable, ma_uint32 unitCount,
+                           ma_uint32 channels, ma_uint32 sampleRate, ma_uint32 xfadeFrames) {
+    if (cache->joins && cache->unitCount == unitCount && cache->xfadeFrames == xfadeFrames &&
+        cache->channels == channels && cache->sampleRate == sampleRate) {
+        return true;
+    }
+
+    FreeTransitionCache(cache);
+    if (xfadeFrames == 0 || unitCount == 0) {
+        return false;
+    }
+
+    size_t joinSamples = (size_t)xfadeFrames * channels;
+    cache->joins = (float*)ma_malloc((size_t)unitCount * unitCount * joinSamples * sizeof(float), NULL);
+    cache->valid = (ma_uint8*)ma_malloc((size_t)unitCount * unitCount, NULL);
+    if (!cache->joins || !cache->valid) {
+        FreeTransitionCache(cache);
+        return false;
+    }
+
+    for (ma_uint32 a = 0; a < unitCount; a++) {
+        for (ma_uint32 b = 0; b < unitCount; b++) {
+            const UnitClip* ca = &clipTable[a];
+            const UnitClip* cb = &clipTable[b];
+            size_t pair = (size_t)a * unitCount + b;
+            cache->valid[pair] = ca->frameCount >= xfadeFrames && cb->frameCount >= xfadeFrames;
+            if (cache->valid[pair]) {
+                CrossfadeFrames(cache->joins + pair * joinSamples, ca->pcm + (ca->frameCount - xfadeFrames) * channels, 1.0f,
+                                cb->pcm, 1.0f, xfadeFrames, channels);
+            }
+        }
+    }
+
+    cache->unitCount = unitCount;
+    cache->xfadeFrames = xfadeFrames;
+    cache->channels = channels;
+    cache->sampleRate = sampleRate;
+    return true;
+}
+
+// Writes frames [firstFrame, firstFrame + frameCount) of the join between clip units a and b.
+// Copies from the cache when it has the join, blends otherwise.
+static inline void WriteJoinFrames(float* dst, const UnitClip* clipTable, const TransitionCache* transitions,
+                                   ma_uint8 a, float gainA, ma_uint8 b, float gainB,
+                                   ma_uint64 firstFrame, ma_uint64 frameCount, ma_uint64 overlap, ma_uint32 channels) {
+    if (transitions && gainA == 1.0f && gainB == 1.0f && overlap == transitions->xfadeFrames &&
+        channels == transitions->channels && a < transitions->unitCount && b < transitions->unitCount) {
+        size_t pair = (size_t)a * transitions->unitCount + b;
+        if (transitions->valid[pair]) {
+            const float* join = transitions->joins + pair * overlap * channels;
+            memcpy(dst, join + firstFrame * channels, (size_t)(frameCount * channels) * sizeof(float));
+            return;
+        }
+    }
+
+    const UnitClip* ca = &clipTable[a];
+    CrossfadeFrameRange(dst, ca->pcm + (ca->frameCount - overlap) * channels, gainA, clipTable[b].pcm, gainB,
+                        firstFrame, frameCount, overlap, channels);
+}
+
+// Renders a unit id stream. Every id is resolved through clipTable (indexed by Unit), so the
+// utterance itself stays a byte per syllable. gains is optional, one per unit.
+//
+// Every output frame is written exactly once: the parts of a clip nobody overlaps are copied
+// straight from the clip and each overlap is computed from both sources as a*(1-t) + b*t, or
+// copied from transitions when given.
+//
+// The pcm comes from allocator. With an arena, resetting it releases the utterance; audio handed
+// to PlayRendered must come from the heap.
 RenderedAudio RenderConcatenated(
-    const UnitClip* clips, const float* gains, int clipCount,
+    const UnitClip* clipTable, const ma_uint8* units, const float* gains, int unitCount,
     ma_uint32 channels, ma_uint32 sampleRate,
-    ma_uint32 xfadeFrames)
+    ma_uint32 xfadeFrames, const TransitionCache* transitions = 0, Allocator allocator = HeapAllocator)
 {
+    PROFILE_ZONE("render");
     // Compute total frames accounting for overlap.
     ma_uint64 total = 0;
-    for (int i = 0; i < clipCount; i++) {
-        total += clips[i].frameCount;
+    ma_uint64 overlapIn = 0;
+    for (int i = 0; i < unitCount; i++) {
+        total += clipTable[units[i]].frameCount;
         if (i > 0) {
-            ma_uint64 overlap = (clips[i-1].frameCount < xfadeFrames) ? clips[i-1].frameCount : xfadeFrames;
-            overlap = (clips[i].frameCount < overlap) ? clips[i].frameCount : overlap;
-            total -= overlap;
+            overlapIn = ClampOverlap(clipTable[units[i-1]].frameCount, overlapIn, clipTable[units[i]].frameCount, xfadeFrames);
+            total -= overlapIn;
         }
     }
 
-    RenderedAudio out = {0};
+    RenderedAudio out = {};
     out.channels = channels;
     out.sampleRate = sampleRate;
     out.frameCount = total;
-    out.pcm = (float*)ma_malloc((size_t)(total * channels * sizeof(float)), NULL);
+    out.pcm = ALLOC_ARRAY(allocator, float, total * channels);
     if (!out.pcm) return out;
 
-    // Zero output.
-    memset(out.pcm, 0, (size_t)(total * channels * sizeof(float)));
+    float* dst = out.pcm;
+    overlapIn = 0;
 
-    ma_uint64 writeFrame = 0;
-
-    for (int i = 0; i < clipCount; i++) {
-        const UnitClip* c = &clips[i];
+    for (int i = 0; i < unitCount; i++) {
+        const UnitClip* c = &clipTable[units[i]];
         const float gain = gains ? gains[i] : 1.0f;
 
-        // Determine overlap with previous clip.
-        ma_uint64 overlap = 0;
-        if (i > 0) {
-            overlap = xfadeFrames;
-            if (clips[i-1].frameCount < overlap) overlap = clips[i-1].frameCount;
-            if (c->frameCount < overlap) overlap = c->frameCount;
+        ma_uint64 overlapOut = 0;
+        if (i + 1 < unitCount) {
+            overlapOut = ClampOverlap(c->frameCount, overlapIn, clipTable[units[i+1]].frameCount, xfadeFrames);
         }
 
-        // Non-overlapped region start in output:
-        // we back up by overlap frames to blend.
-        ma_uint64 dstStart = (i == 0) ? writeFrame : (writeFrame - overlap);
+        // The head of this clip was already blended in with the previous one.
+        ma_uint64 bodyFrames = c->frameCount - overlapIn - overlapOut;
+        ScaleSamples(dst, c->pcm + overlapIn * channels, bodyFrames * channels, gain);
+        dst += bodyFrames * channels;
 
-        // Copy/blend.
-        for (ma_uint64 f = 0; f < c->frameCount; f++) {
-            float w = gain;
-
-            // Apply fade-in for the overlapped start.
-            if (overlap > 0 && f < overlap) {
-                float t = (float)f / (float)(overlap - 1 ? overlap - 1 : 1);
-                // fade-in weight for new clip; old clip already in buffer gets complementary fade-out
-                w *= t;
-            }
-
-            ma_uint64 dstF = dstStart + f;
-            if (dstF >= out.frameCount) break;
-
-            for (ma_uint32 ch = 0; ch < channels; ch++) {
-                float s = c->pcm[f * channels + ch] * w;
-                out.pcm[dstF * channels + ch] += s;
-            }
+        // Fade this clip's tail out while the next clip's head fades in.
+        if (overlapOut > 0) {
+            const float nextGain = gains ? gains[i+1] : 1.0f;
+            WriteJoinFrames(dst, clipTable, transitions, units[i], gain, units[i+1], nextGain, 0, overlapOut, overlapOut, channels);
+            dst += overlapOut * channels;
         }
 
-        // Now apply fade-out to previous material already in buffer (complement).
-        // We do it by scaling the overlapped region that was previously written.
-        if (overlap > 0) {
-            ma_uint64 fadeStart = writeFrame - overlap;
-            for (ma_uint64 f = 0; f < overlap; f++) {
-                float t = (float)f / (float)(overlap - 1 ? overlap - 1 : 1);
-                float oldScale = 1.0f - t;
-                ma_uint64 dstF = fadeStart + f;
-                for (ma_uint32 ch = 0; ch < channels; ch++) {
-                    // Scale only the portion that existed before this clip.
-                    // This is a simple approach; in practice you might separate buffers.
-                    out.pcm[dstF * channels + ch] *= oldScale;
-                }
-            }
-        }
-
-        // Advance writeFrame (minus overlap already accounted for).
-        writeFrame = dstStart + c->frameCount;
+        overlapIn = overlapOut;
     }
 
     return out;
 }
 
-void FreeRendered(RenderedAudio* a)
+void FreeRendered(RenderedAudio* a, Allocator allocator = HeapAllocator)
 {
-    if (a->pcm) ma_free(a->pcm, 0);
+    if (a->pcm && allocator.free) allocator.free(allocator.context, a->pcm);
+    a->pcm = 0;
 }
 
 typedef struct Playback {
@@ -160,4 +232,6 @@ void PlayRendered(ma_engine* engine, RenderedAudio* a) {
     
     ma_sound_set_pitch(&p->sound, 1.25f); 
     ma_sound_start(&p->sound);
-}
\ No newline at end of file
+}
+
+#endif // _SPEECH_AUDIO_H_
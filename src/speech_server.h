@@ -0,0 +1,345 @@
+#ifndef _SPEECH_SERVER_H_
+#define _SPEECH_SERVER_H_
+
+#include "alien_translator.h"
+#include "unit_clip_loader.h"
+#include "render_stream.h"
+#include "profiler_timer.h"
+#include "memory_arena.h"
+#include <stdarg.h>
+
+#if defined(_WIN32)
+    #include <io.h>
+    #include <fcntl.h>
+#endif
+
+// Long running mode for games and tools: the dictionary, the clips and the audio engine are loaded
+// once, then requests are read from stdin one per line, so a request only pays for translation
+// and rendering. Every request gets exactly one response line on stdout:
+//
+//     translate <text>          -> ok <unit count> <unit names...>
+//     render <file.wav> <text>  -> ok <frames> <microseconds>           (f32 WAV)
+//     pcm <text>                -> ok <frames> <channels> <sample rate> <microseconds>
+//                                  followed by frames * channels raw little-endian f32 samples
+//     play <text>               -> ok <frames> <microseconds>           (returns once playback starts)
+//     stop                      -> ok
+//     quit                      -> ok, then the server exits
+//
+// Errors are answered with "error <message>". Words missing from the dictionary are skipped, like
+// everywhere else. The audio engine is only started by the first play request.
+
+#define SPEECH_SERVER_MAX_VOICES    8
+#define SPEECH_SERVER_SCRATCH_SIZE  (256 * 1024 * 1024)
+#define SPEECH_VOICE_MEMORY_SIZE    (16 * 1024 * 1024)
+#define SPEECH_SERVER_WRITE_BUFFER  (256 * 1024)
+
+// A playing utterance. The stream has to outlive the sound (and the request), so its plan lives in
+// the voice's own arena until the sound is done.
+struct SpeechVoice {
+    Arena memory;
+    RenderStream stream;
+    ma_sound sound;
+    bool active;
+};
+
+// Request memory (translation scratch, unit ids, plans and pcm) comes from scratch, which is reset
+// after every request, so a warmed-up server doesn't call malloc.
+struct SpeechServer {
+    CMU_Dictionary* dict;
+    UnitClipSet* clips;
+    const TransitionCache* transitions;
+    u32 xfade_frames;
+
+    Arena scratch;
+
+    ma_engine engine;
+    bool engine_ready;
+    SpeechVoice voices[SPEECH_SERVER_MAX_VOICES];
+};
+
+// The dictionary must have units.
+bool InitSpeechServer(SpeechServer* server, CMU_Dictionary* dict, UnitClipSet* clips, u32 xfade_frames,
+                      const TransitionCache* transitions) {
+    ZeroStruct(server);
+    server->dict = dict;
+    server->clips = clips;
+    server->transitions = transitions;
+    server->xfade_frames = xfade_frames;
+    return dict->has_units && ReserveArena(&server->scratch, SPEECH_SERVER_SCRATCH_SIZE);
+}
+
+internal void ReleaseVoice(SpeechVoice* voice) {
+    if (voice->active) {
+        ma_sound_uninit(&voice->sound);
+        FreeRenderStream(&voice->stream, ArenaAllocator(&voice->memory));
+        ResetArena(&voice->memory);
+        voice->active = false;
+    }
+}
+
+void FreeSpeechServer(SpeechServer* server) {
+    for (int i = 0; i < SPEECH_SERVER_MAX_VOICES; i++) {
+        ReleaseVoice(&server->voices[i]);
+        ReleaseArena(&server->voices[i].memory);
+    }
+    if (server->engine_ready) {
+        ma_engine_uninit(&server->engine);
+    }
+    ReleaseArena(&server->scratch);
+}
+
+internal void Respond(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vfprintf(stdout, format, args);
+    va_end(args);
+    fputc('\n', stdout);
+    fflush(stdout);
+}
+
+internal bool TranslateRequest(SpeechServer* server, const char* text, UnitBuffer* units) {
+    Allocator scratch = ArenaAllocator(&server->scratch);
+    TranslationContext translator;
+    InitTranslationContext(&translator, server->dict, scratch);
+    *units = {};
+    units->allocator = scratch;
+
+    if (!TranslateText(&translator, text, CStringLength(text), UnitBufferSink(units))) {
+        Respond("error out of memory while translating");
+        return false;
+    }
+    return true;
+}
+
+// Translates text and builds a render plan for it in plan_allocator.
+internal bool PlanUtterance(SpeechServer* server, const char* text, RenderStream* stream, Allocator plan_allocator) {
+    UnitBuffer units;
+    if (!TranslateRequest(server, text, &units)) {
+        return false;
+    }
+
+    UnitClipSet* clips = server->clips;
+    PrepareUnitClips(clips, units.units, units.count);
+    if (!InitRenderStream(stream, clips->clips, units.units, 0, units.count,
+                          clips->channels, clips->sample_rate, server->xfade_frames, plan_allocator)) {
+        FreeRenderStream(stream, plan_allocator);
+        Respond("error out of memory while planning the render");
+        return false;
+    }
+    stream->transitions = server->transitions;
+    return true;
+}
+
+internal u64 ElapsedMicroseconds(Timer timer) {
+    return (u64)(StopTimer(timer) * 1000.0);
+}
+
+internal void HandleTranslate(SpeechServer* server, const char* text) {
+    UnitBuffer units;
+    if (!TranslateRequest(server, text, &units)) {
+        return;
+    }
+
+    printf("ok %d", units.count);
+    for (int i = 0; i < units.count; i++) {
+        printf(" %s", UnitStrings[units.units[i]]);
+    }
+    Respond("");
+}
+
+internal void HandleRender(SpeechServer* server, const char* arguments) {
+    const char* path_end = arguments;
+    while (*path_end && !IsWhitespace(*path_end)) {
+        path_end++;
+    }
+
+    char path[1024];
+    int path_length = (int)(path_end - arguments);
+    if (path_length == 0 || path_length >= (int)sizeof(path)) {
+        Respond("error render needs a file path");
+        return;
+    }
+    memcpy(path, arguments, path_length);
+    path[path_length] = 0;
+
+    Timer timer = StartTimer();
+    Allocator scratch = ArenaAllocator(&server->scratch);
+    RenderStream stream;
+    if (!PlanUtterance(server, path_end, &stream, scratch)) {
+        return;
+    }
+
+    u8* write_buffer = (u8*)ArenaPush(&server->scratch, SPEECH_SERVER_WRITE_BUFFER);
+    bool success = write_buffer && WriteStreamToWav(&stream, path, WavSampleFormat_F32, write_buffer, SPEECH_SERVER_WRITE_BUFFER);
+    u64 frames = stream.frame_count;
+    FreeRenderStream(&stream, scratch);
+    if (success) {
+        Respond("ok %llu %llu", (unsigned long long)frames, (unsigned long long)ElapsedMicroseconds(timer));
+    } else {
+        Respond("error failed to write %s", path);
+    }
+}
+
+internal void HandlePcm(SpeechServer* server, const char* text) {
+    Timer timer = StartTimer();
+    Allocator scratch = ArenaAllocator(&server->scratch);
+    RenderStream stream;
+    if (!PlanUtterance(server, text, &stream, scratch)) {
+        return;
+    }
+
+    // Render before answering, so the timing excludes however fast the client reads.
+    u64 sample_count = stream.frame_count * stream.channels;
+    float* samples = ALLOC_ARRAY(scratch, float, sample_count ? sample_count : 1);
+    if (!samples) {
+        FreeRenderStream(&stream, scratch);
+        Respond("error out of memory while rendering");
+        return;
+    }
+    {
+        PROFILE_ZONE("render");
+        ReadRenderStream(&stream, samples, stream.frame_count);
+    }
+
+    Respond("ok %llu %u %u %llu", (unsigned long long)stream.frame_count, stream.channels, stream.sample_rate,
+            (unsigned long long)ElapsedMicroseconds(timer));
+    fwrite(samples, sizeof(float), (size_t)sample_count, stdout);
+    fflush(stdout);
+
+    FreeRenderStream(&stream, scratch);
+}
+
+internal void HandlePlay(SpeechServer* server, const char* text) {
+    if (!server->engine_ready) {
+        if (ma_engine_init(0, &server->engine) != MA_SUCCESS) {
+            Respond("error no audio device");
+            return;
+        }
+        server->engine_ready = true;
+    }
+
+    // Reuse a voice that finished playing. If every voice is busy, the first one is cut off.
+    SpeechVoice* voice = &server->voices[0];
+    for (int i = 0; i < SPEECH_SERVER_MAX_VOICES; i++) {
+        SpeechVoice* candidate = &server->voices[i];
+        if (!candidate->active || ma_sound_at_end(&candidate->sound)) {
+            voice = candidate;
+            break;
+        }
+    }
+    ReleaseVoice(voice);
+    if (!voice->memory.base && !ReserveArena(&voice->memory, SPEECH_VOICE_MEMORY_SIZE)) {
+        Respond("error out of memory while starting a voice");
+        return;
+    }
+
+    Timer timer = StartTimer();
+    Allocator voice_allocator = ArenaAllocator(&voice->memory);
+    if (!PlanUtterance(server, text, &voice->stream, voice_allocator)) {
+        ResetArena(&voice->memory);
+        return;
+    }
+    if (!PlayStream(&server->engine, &voice->stream, &voice->sound)) {
+        FreeRenderStream(&voice->stream, voice_allocator);
+        ResetArena(&voice->memory);
+        Respond("error failed to start playback");
+        return;
+    }
+    voice->active = true;
+
+    Respond("ok %llu %llu", (unsigned long long)voice->stream.frame_count, (unsigned long long)ElapsedMicroseconds(timer));
+}
+
+// Reads one line of any length into *line (grown as needed, without the newline). Returns false at
+// the end of input.
+internal bool ReadRequestLine(FILE* input, char** line, int* capacity) {
+    int length = 0;
+    int c;
+    while ((c = fgetc(input)) != EOF && c != '\n') {
+        if (length + 2 > *capacity) {
+            int grown_capacity = *capacity ? *capacity * 2 : 1024;
+            char* grown = (char*)realloc(*line, grown_capacity);
+            if (!grown) {
+                return false;
+            }
+            *line = grown;
+            *capacity = grown_capacity;
+        }
+        (*line)[length++] = (char)c;
+    }
+
+    if (c == EOF && length == 0) {
+        return false;
+    }
+    if (length > 0 && (*line)[length - 1] == '\r') {
+        length--;
+    }
+    if (*line) {
+        (*line)[length] = 0;
+    }
+    return true;
+}
+
+// Splits "command arguments" in place. Returns the arguments (possibly empty).
+internal char* SplitCommand(char* line) {
+    char* at = line;
+    while (*at && !IsWhitespace(*at)) {
+        at++;
+    }
+    if (*at) {
+        *at++ = 0;
+    }
+    while (IsWhitespace(*at)) {
+        at++;
+    }
+    return at;
+}
+
+// Serves requests until quit or the end of input, then lets lines that are still playing finish.
+void RunSpeechServer(SpeechServer* server) {
+#if defined(_WIN32)
+    _setmode(_fileno(stdout), _O_BINARY); // pcm responses are binary.
+#endif
+
+    char* line = 0;
+    int capacity = 0;
+    while (ReadRequestLine(stdin, &line, &capacity)) {
+        if (!line || line[0] == 0) {
+            continue;
+        }
+
+        PROFILE_ZONE("request");
+        char* arguments = SplitCommand(line);
+        if (strcmp(line, "translate") == 0) {
+            HandleTranslate(server, arguments);
+        } else if (strcmp(line, "render") == 0) {
+            HandleRender(server, arguments);
+        } else if (strcmp(line, "pcm") == 0) {
+            HandlePcm(server, arguments);
+        } else if (strcmp(line, "play") == 0) {
+            HandlePlay(server, arguments);
+        } else if (strcmp(line, "stop") == 0) {
+            for (int i = 0; i < SPEECH_SERVER_MAX_VOICES; i++) {
+                ReleaseVoice(&server->voices[i]);
+            }
+            Respond("ok");
+        } else if (strcmp(line, "quit") == 0) {
+            Respond("ok");
+            break;
+        } else {
+            Respond("error unknown request %s", line);
+        }
+        ResetArena(&server->scratch);
+    }
+
+    free(line);
+
+    for (int i = 0; i < SPEECH_SERVER_MAX_VOICES; i++) {
+        SpeechVoice* voice = &server->voices[i];
+        while (voice->active && !ma_sound_at_end(&voice->sound)) {
+            SleepMilliseconds(10);
+        }
+    }
+}
+
+#endif // _SPEECH_SERVER_H_
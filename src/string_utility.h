@@ -49,7 +49,7 @@ String ToString(DynamicString* dynamicString) {
 }
 
 void InitDynamicString(DynamicString* string, Allocator allocator, u32 capacity) {
-    string->buffer = (char*)allocator.alloc(capacity);
+    string->buffer = (char*)allocator.alloc(allocator.context, capacity);
     memset(string->buffer, 0, capacity);
     string->length = 0;
     string->capacity = capacity;
@@ -57,13 +57,13 @@ void InitDynamicString(DynamicString* string, Allocator allocator, u32 capacity)
 }
 
 void Resize(DynamicString* string, size_t size) {
-    char* buffer = (char*)string->allocator.alloc(size);
+    char* buffer = (char*)string->allocator.alloc(string->allocator.context, size);
     size_t copySize = (string->length < size - 1) ? string->length : size - 1;
     
     memcpy(buffer, string->buffer, copySize);
     buffer[copySize] = '\0';
     
-    string->allocator.free(string->buffer);
+    string->allocator.free(string->allocator.context, string->buffer);
     string->buffer = buffer;
     string->capacity = size; 
     string->length = copySize;
@@ -73,7 +73,7 @@ void SetDynamicString(DynamicString* string, const char* cStr) {
     u32 length = CStringLength(cStr);
     
     if (length >= string->capacity) {
-        string->buffer = (char*)string->allocator.alloc(length + 1);
+        string->buffer = (char*)string->allocator.alloc(string->allocator.context, length + 1);
         string->capacity = length;
     }
     
@@ -191,11 +191,11 @@ void TruncateLastDirectory(char* directory, u32 length) {
     }
 }
 
-char* GetSubstringBeforeHash(const char* str, AllocFunc alloc) {
+char* GetSubstringBeforeHash(const char* str, Allocator allocator) {
     const char* hash = strchr(str, '#');
     size_t length = hash ? (size_t)(hash - str) : strlen(str);
     
-    char* result = (char*)alloc(length + 1);
+    char* result = (char*)allocator.alloc(allocator.context, length + 1);
     if (!result) return 0;
 
     memcpy(result, str, length);
@@ -0,0 +1,46 @@
+#ifndef _TEXT_LINES_H_
+#define _TEXT_LINES_H_
+
+#include "string_utility.h"
+
+struct TextLine {
+    const char* text;
+    u32 length;
+    u32 line_number;
+};
+
+// Finds the non-blank lines (\n or \r\n) in text without copying or modifying it: every TextLine
+// points into text, so text must outlive lines. lines must hold one entry per line of text;
+// returns how many were filled.
+int SplitTextLines(const char* text, size_t length, TextLine* lines) {
+    int count = 0;
+    u32 line_number = 0;
+    size_t at = 0;
+    while (at < length) {
+        size_t start = at;
+        while (at < length && text[at] != '\n') {
+            at++;
+        }
+        size_t end = at;
+        at++;
+        line_number++;
+
+        if (end > start && text[end - 1] == '\r') {
+            end--;
+        }
+
+        bool blank = true;
+        for (size_t i = start; i < end && blank; i++) {
+            blank = IsWhitespace(text[i]);
+        }
+        if (!blank) {
+            lines[count].text = text + start;
+            lines[count].length = (u32)(end - start);
+            lines[count].line_number = line_number;
+            count++;
+        }
+    }
+    return count;
+}
+
+#endif // _TEXT_LINES_H_
@@ -0,0 +1,267 @@
+#ifndef _THREADING_H_
+#define _THREADING_H_
+
+#include <assert.h>
+#include "utility.h"
+
+/* PLATFORM SPECIFIC */
+#if defined(_WIN32)
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include "windows.h"
+#else
+    #include <pthread.h>
+    #include <sched.h>
+    #include <unistd.h>
+    #include <time.h>
+    #include <errno.h>
+#endif
+
+typedef void (*ThreadProc)(void* data);
+
+// The Thread must stay alive (and not move) until JoinThread returns.
+struct Thread {
+    ThreadProc proc;
+    void* data;
+#if defined(_WIN32)
+    HANDLE handle;
+#else
+    pthread_t handle;
+#endif
+};
+
+#if defined(_WIN32)
+
+internal DWORD WINAPI ThreadEntry(LPVOID param) {
+    Thread* thread = (Thread*)param;
+    thread->proc(thread->data);
+    return 0;
+}
+
+bool StartThread(Thread* thread, ThreadProc proc, void* data) {
+    thread->proc = proc;
+    thread->data = data;
+    thread->handle = CreateThread(0, 0, ThreadEntry, thread, 0, 0);
+    return thread->handle != 0;
+}
+
+void JoinThread(Thread* thread) {
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+    thread->handle = 0;
+}
+
+u32 GetProcessorCount() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors ? info.dwNumberOfProcessors : 1;
+}
+
+void YieldThread() {
+    SwitchToThread();
+}
+
+void SleepMilliseconds(u32 milliseconds) {
+    Sleep(milliseconds);
+}
+
+// Sequentially consistent, like the Interlocked functions they wrap.
+inline s32 AtomicLoad(volatile s32* value) {
+    return InterlockedCompareExchange((volatile LONG*)value, 0, 0);
+}
+
+inline void AtomicStore(volatile s32* value, s32 new_value) {
+    InterlockedExchange((volatile LONG*)value, new_value);
+}
+
+// Returns the value before the add.
+inline s32 AtomicAdd(volatile s32* value, s32 addend) {
+    return InterlockedExchangeAdd((volatile LONG*)value, addend);
+}
+
+inline bool AtomicCompareExchange(volatile s32* value, s32 expected, s32 desired) {
+    return InterlockedCompareExchange((volatile LONG*)value, desired, expected) == expected;
+}
+
+inline bool AtomicCompareExchangePointer(void* volatile* value, void* expected, void* desired) {
+    return InterlockedCompareExchangePointer(value, desired, expected) == expected;
+}
+
+#else
+
+internal void* ThreadEntry(void* param) {
+    Thread* thread = (Thread*)param;
+    thread->proc(thread->data);
+    return 0;
+}
+
+bool StartThread(Thread* thread, ThreadProc proc, void* data) {
+    thread->proc = proc;
+    thread->data = data;
+    return pthread_create(&thread->handle, 0, ThreadEntry, thread) == 0;
+}
+
+void JoinThread(Thread* thread) {
+    pthread_join(thread->handle, 0);
+}
+
+u32 GetProcessorCount() {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (u32)count : 1;
+}
+
+void YieldThread() {
+    sched_yield();
+}
+
+void SleepMilliseconds(u32 milliseconds) {
+    timespec duration = { (time_t)(milliseconds / 1000), (long)(milliseconds % 1000) * 1000000 };
+    while (nanosleep(&duration, &duration) != 0 && errno == EINTR) {
+    }
+}
+
+inline s32 AtomicLoad(volatile s32* value) {
+    return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+}
+
+inline void AtomicStore(volatile s32* value, s32 new_value) {
+    __atomic_store_n(value, new_value, __ATOMIC_SEQ_CST);
+}
+
+inline s32 AtomicAdd(volatile s32* value, s32 addend) {
+    return __atomic_fetch_add(value, addend, __ATOMIC_SEQ_CST);
+}
+
+inline bool AtomicCompareExchange(volatile s32* value, s32 expected, s32 desired) {
+    return __atomic_compare_exchange_n(value, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+inline bool AtomicCompareExchangePointer(void* volatile* value, void* expected, void* desired) {
+    return __atomic_compare_exchange_n(value, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+#endif
+
+#define MAX_PARALLEL_THREADS 64
+
+// Runs proc(items[i]) for every item, one thread per item (at most MAX_PARALLEL_THREADS). The
+// calling thread runs the first item itself. Falls back to running everything on the calling
+// thread if a thread fails to start.
+void RunInParallel(ThreadProc proc, void* items, size_t item_size, u32 count) {
+    Thread threads[MAX_PARALLEL_THREADS];
+    bool started[MAX_PARALLEL_THREADS] = {};
+    assert(count <= MAX_PARALLEL_THREADS);
+
+    u8* at = (u8*)items;
+    for (u32 i = 1; i < count; i++) {
+        started[i] = StartThread(&threads[i], proc, at + i * item_size);
+    }
+
+    if (count > 0) {
+        proc(at);
+    }
+
+    for (u32 i = 1; i < count; i++) {
+        if (started[i]) {
+            JoinThread(&threads[i]);
+        } else {
+            proc(at + i * item_size);
+        }
+    }
+}
+
+// Runs proc(data) exactly once across all threads. Threads that arrive while another one is
+// running it wait until it is done. Zero-initialize before first use.
+struct OnceFlag {
+    volatile s32 state;
+};
+
+enum {
+    OnceState_None = 0,
+    OnceState_Running,
+    OnceState_Done
+};
+
+void RunOnce(OnceFlag* once, ThreadProc proc, void* data) {
+    if (AtomicLoad(&once->state) == OnceState_Done) {
+        return;
+    }
+    
+    if (AtomicCompareExchange(&once->state, OnceState_None, OnceState_Running)) {
+        proc(data);
+        AtomicStore(&once->state, OnceState_Done);
+        return;
+    }
+    
+    while (AtomicLoad(&once->state) != OnceState_Done) {
+        YieldThread();
+    }
+}
+
+// Small fixed pool for a known list of independent items. Workers (and whoever calls
+// FinishWorkQueue) pull the next item index from a shared counter until the list is empty, so
+// uneven items still spread across the threads. The queue must not move until FinishWorkQueue.
+#define MAX_WORK_QUEUE_THREADS 16
+
+struct WorkQueue {
+    ThreadProc proc;
+    u8* items;
+    size_t item_size;
+    s32 item_count;
+    volatile s32 next_item;
+    
+    Thread threads[MAX_WORK_QUEUE_THREADS];
+    bool started[MAX_WORK_QUEUE_THREADS];
+    u32 thread_count;
+};
+
+internal void DrainWorkQueue(WorkQueue* queue) {
+    for (;;) {
+        s32 index = AtomicAdd(&queue->next_item, 1);
+        if (index >= queue->item_count) {
+            break;
+        }
+        queue->proc(queue->items + index * queue->item_size);
+    }
+}
+
+internal void WorkQueueThread(void* data) {
+    DrainWorkQueue((WorkQueue*)data);
+}
+
+// Starts working through items in the background and returns immediately.
+void StartWorkQueue(WorkQueue* queue, ThreadProc proc, void* items, size_t item_size, u32 count, u32 thread_count) {
+    queue->proc = proc;
+    queue->items = (u8*)items;
+    queue->item_size = item_size;
+    queue->item_count = (s32)count;
+    queue->next_item = 0;
+    
+    if (thread_count > MAX_WORK_QUEUE_THREADS) {
+        thread_count = MAX_WORK_QUEUE_THREADS;
+    }
+    if (thread_count > count) {
+        thread_count = count;
+    }
+    queue->thread_count = thread_count;
+    
+    for (u32 i = 0; i < thread_count; i++) {
+        queue->started[i] = StartThread(&queue->threads[i], WorkQueueThread, queue);
+    }
+}
+
+// Helps with the remaining items on the calling thread and waits for the workers.
+// Every item is done once this returns, even if no thread could be started.
+void FinishWorkQueue(WorkQueue* queue) {
+    DrainWorkQueue(queue);
+    for (u32 i = 0; i < queue->thread_count; i++) {
+        if (queue->started[i]) {
+            JoinThread(&queue->threads[i]);
+            queue->started[i] = false;
+        }
+    }
+    queue->thread_count = 0;
+}
+
+#endif // _THREADING_H_
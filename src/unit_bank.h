@@ -0,0 +1,143 @@
+#ifndef _UNIT_BANK_H_
+#define _UNIT_BANK_H_
+
+#include "file_io.h"
+#include "speech_audio.h"
+#include "alien_speech_data.h"
+
+// Pre-decoded PCM for every Unit in one file.
+//
+// The compiler (compiler_main.cpp --bank) decodes the unit MP3s once at the output format and
+// writes the f32 frames behind a small table. At runtime the bank is mapped read-only and every
+// UnitClip::pcm points straight into it, so startup does no decoding or allocation and processes
+// that map the same bank share its pages.
+//
+// Layout (each section starts on a UNIT_BANK_ALIGNMENT boundary):
+//     UnitBankHeader
+//     UnitBankClip[unit_count]
+//     f32[frame_count * channels] for every clip, in Unit order
+
+#define UNIT_BANK_MAGIC     0x4B4E4255 // "UBNK"
+#define UNIT_BANK_VERSION   1
+#define UNIT_BANK_ALIGNMENT 64
+
+struct UnitBankHeader {
+    u32 magic;
+    u32 version;
+
+    u32 unit_count;
+    u32 channels;
+    u32 sample_rate;
+    u32 reserved;
+
+    u64 clips_offset;
+};
+
+struct UnitBankClip {
+    char name[4];       // UnitStrings name, so a bank built for another symbols.xmacro is rejected.
+    u32 reserved;
+    u64 pcm_offset;     // Byte offset from the start of the file.
+    u64 frame_count;
+};
+
+// clips must hold Unit_Count decoded clips, all in the given format.
+bool SaveUnitBank(const char* filepath, const UnitClip* clips, u32 channels, u32 sample_rate) {
+    UnitBankHeader header = {};
+    header.magic = UNIT_BANK_MAGIC;
+    header.version = UNIT_BANK_VERSION;
+    header.unit_count = Unit_Count;
+    header.channels = channels;
+    header.sample_rate = sample_rate;
+
+    u64 position = AlignUp(sizeof(UnitBankHeader), UNIT_BANK_ALIGNMENT);
+    header.clips_offset = position;
+    position += Unit_Count * sizeof(UnitBankClip);
+
+    UnitBankClip table[Unit_Count] = {};
+    for (int i = 0; i < Unit_Count; i++) {
+        if (clips[i].channels != channels || clips[i].sampleRate != sample_rate) {
+            fprintf(stderr, "Unit %s is not %u channel(s) at %u Hz.\n", UnitStrings[i], channels, sample_rate);
+            return false;
+        }
+
+        memcpy(table[i].name, UnitStrings[i], 2);
+        position = AlignUp(position, UNIT_BANK_ALIGNMENT);
+        table[i].pcm_offset = position;
+        table[i].frame_count = clips[i].frameCount;
+        position += clips[i].frameCount * channels * sizeof(float);
+    }
+
+    bool success = false;
+    FILE* file = fopen(filepath, "wb");
+    if (file) {
+        position = 0;
+        success = fwrite(&header, sizeof(header), 1, file) == 1;
+        position += sizeof(header);
+
+        success = success && WritePadding(file, &position, UNIT_BANK_ALIGNMENT);
+        success = success && fwrite(table, sizeof(UnitBankClip), Unit_Count, file) == Unit_Count;
+        position += Unit_Count * sizeof(UnitBankClip);
+
+        for (int i = 0; i < Unit_Count; i++) {
+            size_t sample_count = (size_t)(clips[i].frameCount * channels);
+            success = success && WritePadding(file, &position, UNIT_BANK_ALIGNMENT);
+            success = success && fwrite(clips[i].pcm, sizeof(float), sample_count, file) == sample_count;
+            position += sample_count * sizeof(float);
+        }
+
+        success = (fclose(file) == 0) && success;
+    }
+
+    if (!success) {
+        fprintf(stderr, "Failed to write %s.\n", filepath);
+    }
+    return success;
+}
+
+// Maps a bank and points clips[Unit_Count] into it. The clips are read-only, must not be passed to
+// FreeClip and stay valid until UnloadUnitBank.
+bool LoadUnitBank(const char* filepath, UnitClip* clips, u32 channels, u32 sample_rate, MappedFile* bank) {
+    if (!MapFileReadOnly(filepath, bank)) {
+        fprintf(stderr, "Failed to map %s.\n", filepath);
+        return false;
+    }
+
+    UnitBankHeader* header = (UnitBankHeader*)bank->data;
+    bool valid = bank->size >= sizeof(UnitBankHeader);
+    if (valid) {
+        valid = header->magic == UNIT_BANK_MAGIC && header->version == UNIT_BANK_VERSION &&
+                header->unit_count == Unit_Count &&
+                header->channels == channels && header->sample_rate == sample_rate &&
+                header->clips_offset + Unit_Count * sizeof(UnitBankClip) <= bank->size;
+    }
+
+    UnitBankClip* table = valid ? (UnitBankClip*)(bank->data + header->clips_offset) : 0;
+    for (int i = 0; valid && i < Unit_Count; i++) {
+        u64 size = table[i].frame_count * channels * sizeof(float);
+        valid = memcmp(table[i].name, UnitStrings[i], 2) == 0 &&
+                table[i].pcm_offset % sizeof(float) == 0 &&
+                table[i].pcm_offset + size <= bank->size;
+    }
+
+    if (!valid) {
+        fprintf(stderr, "%s is not a compatible unit bank (expected version %d, %u channel(s) at %u Hz).\n",
+                filepath, UNIT_BANK_VERSION, channels, sample_rate);
+        UnmapFile(bank);
+        return false;
+    }
+
+    for (int i = 0; i < Unit_Count; i++) {
+        clips[i].pcm = (float*)(bank->data + table[i].pcm_offset);
+        clips[i].frameCount = table[i].frame_count;
+        clips[i].channels = channels;
+        clips[i].sampleRate = sample_rate;
+    }
+    return true;
+}
+
+void UnloadUnitBank(UnitClip* clips, MappedFile* bank) {
+    UnmapFile(bank);
+    memset(clips, 0, Unit_Count * sizeof(UnitClip));
+}
+
+#endif // _UNIT_BANK_H_
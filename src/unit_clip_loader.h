@@ -0,0 +1,114 @@
+#ifndef _UNIT_CLIP_LOADER_H_
+#define _UNIT_CLIP_LOADER_H_
+
+#include "threading.h"
+#include "unit_bank.h"
+#include "profiler_timer.h"
+
+// Owns the clip table RenderConcatenated reads, however the clips got there:
+//     bank      - mapped from a unit bank, nothing to decode.
+//     parallel  - every MP3 is decoded on a small pool in the background while the caller does
+//                 other start-up work (dictionary, audio engine), then FinishDecodingUnitClips.
+//     lazy      - nothing is decoded up front; a unit is decoded the first time it is used.
+// Every clip is guarded by a once-flag, so the modes can mix safely (e.g. a lazy request for a
+// clip the pool hasn't reached yet decodes it right away).
+
+enum UnitClipLoadMode {
+    UnitClipLoad_Parallel = 0,
+    UnitClipLoad_Lazy
+};
+
+struct UnitClipSet;
+
+struct UnitDecodeJob {
+    UnitClipSet* set;
+    int unit;
+};
+
+struct UnitClipSet {
+    UnitClip clips[Unit_Count];
+    OnceFlag decoded[Unit_Count];
+    UnitDecodeJob jobs[Unit_Count];
+
+    u32 channels;
+    u32 sample_rate;
+
+    MappedFile bank;
+    WorkQueue queue;
+};
+
+void InitUnitClips(UnitClipSet* set, u32 channels, u32 sample_rate) {
+    ZeroStruct(set);
+    set->channels = channels;
+    set->sample_rate = sample_rate;
+    for (int i = 0; i < Unit_Count; i++) {
+        set->jobs[i].set = set;
+        set->jobs[i].unit = i;
+    }
+}
+
+internal void DecodeUnitClip(void* data) {
+    PROFILE_ZONE("decode clip");
+    UnitDecodeJob* job = (UnitDecodeJob*)data;
+    UnitClipSet* set = job->set;
+    const char* path = UnitAssetPaths[job->unit];
+
+    // A clip that fails to decode stays empty and renders as silence.
+    if (!LoadClipF32(&set->clips[job->unit], path, set->channels, set->sample_rate)) {
+        fprintf(stderr, "Failed to load audio file: %s\n", path);
+    }
+}
+
+internal void DecodeUnitClipOnce(void* data) {
+    UnitDecodeJob* job = (UnitDecodeJob*)data;
+    RunOnce(&job->set->decoded[job->unit], DecodeUnitClip, job);
+}
+
+// Every clip is ready when this returns true.
+bool LoadUnitClipsFromBank(UnitClipSet* set, const char* filepath) {
+    PROFILE_ZONE("load unit bank");
+    if (!LoadUnitBank(filepath, set->clips, set->channels, set->sample_rate, &set->bank)) {
+        return false;
+    }
+
+    for (int i = 0; i < Unit_Count; i++) {
+        AtomicStore(&set->decoded[i].state, OnceState_Done);
+    }
+    return true;
+}
+
+// Returns right away. The clips are only safe to read after FinishDecodingUnitClips.
+void StartDecodingUnitClips(UnitClipSet* set, u32 thread_count) {
+    StartWorkQueue(&set->queue, DecodeUnitClipOnce, set->jobs, sizeof(UnitDecodeJob), Unit_Count, thread_count);
+}
+
+void FinishDecodingUnitClips(UnitClipSet* set) {
+    PROFILE_ZONE("finish decoding clips");
+    FinishWorkQueue(&set->queue);
+}
+
+// Decodes the clip on first use. Safe to call from any thread.
+const UnitClip* GetUnitClip(UnitClipSet* set, int unit) {
+    DecodeUnitClipOnce(&set->jobs[unit]);
+    return &set->clips[unit];
+}
+
+// Makes sure every unit in the stream is decoded, so the clip table can be handed to the renderer.
+void PrepareUnitClips(UnitClipSet* set, const u8* units, int unit_count) {
+    for (int i = 0; i < unit_count; i++) {
+        DecodeUnitClipOnce(&set->jobs[units[i]]);
+    }
+}
+
+void FreeUnitClips(UnitClipSet* set) {
+    FinishDecodingUnitClips(set);
+    if (set->bank.data) {
+        UnloadUnitBank(set->clips, &set->bank);
+    } else {
+        for (int i = 0; i < Unit_Count; i++) {
+            FreeClip(&set->clips[i]);
+        }
+    }
+}
+
+#endif // _UNIT_CLIP_LOADER_H_
@@ -176,40 +176,72 @@ unsigned int Align(unsigned int value, unsigned int alignment) {
     return (value + alignment - 1) & ~(alignment - 1);
 }
 
-typedef void* (*AllocFunc)   (size_t size);
-typedef void* (*ReallocFunc) (void*, size_t size);
-typedef void  (*FreeFunc)    (void*);
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+// value must not be 0.
+inline u32 CountTrailingZeros32(u32 value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, value);
+    return index;
+#else
+    return __builtin_ctz(value);
+#endif
+}
+
+inline u32 PopCount32(u32 value) {
+#if defined(_MSC_VER)
+    return __popcnt(value);
+#else
+    return __builtin_popcount(value);
+#endif
+}
+
+// alignment must be a power of two.
+inline u64 AlignUp(u64 value, u64 alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Allocation functions get the context of the Allocator they were called through, so one set of
+// functions can serve many arenas (see memory_arena.h). The heap ignores it.
+typedef void* (*AllocFunc)   (void* context, size_t size);
+typedef void* (*ReallocFunc) (void* context, void*, size_t size);
+typedef void  (*FreeFunc)    (void* context, void*);
 
 struct Allocator {
     AllocFunc alloc;
     ReallocFunc realloc;
     FreeFunc free;
+    void* context;
 };
 
-void* HeapAlloc(size_t size) {
+void* HeapAlloc(void*, size_t size) {
     return malloc(size);
 }
 
-void HeapFree(void* mem) {
+void HeapFree(void*, void* mem) {
     free(mem);
 }
 
-void* HeapRealloc(void* mem, size_t size) {
+void* HeapRealloc(void*, void* mem, size_t size) {
     return realloc(mem, size);
 }
 
 Allocator HeapAllocator = {
     HeapAlloc,
     HeapRealloc,
-    HeapFree
+    HeapFree,
+    0
 };
 
-void FreeStub(void* mem) {
+void FreeStub(void*, void*) {
     // Do Nothing
 }
 
 #define ALLOC_ARRAY(allocator, type, count) \
-    ((type*)((allocator).alloc((size_t)(count) * sizeof(type))))
+    ((type*)((allocator).alloc((allocator).context, (size_t)(count) * sizeof(type))))
 
 #if EDITOR_MODE || _DEBUG
     #define MEM_ALLOC_SIGNATURE(name) void* name(size_t size, const char* file, int line)
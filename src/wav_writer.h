@@ -0,0 +1,137 @@
+#ifndef _WAV_WRITER_H_
+#define _WAV_WRITER_H_
+
+#include "file_io.h"
+
+// Minimal RIFF/WAVE writer on top of the buffered File API. The frame count has to be known up
+// front (it always is for a rendered utterance), so the header is written once and the frames
+// can be streamed in chunks without ever seeking back.
+
+enum WavSampleFormat {
+    WavSampleFormat_F32 = 0,    // IEEE float, written as is.
+    WavSampleFormat_S16         // 16-bit PCM, clamped to [-1, 1].
+};
+
+struct WavWriter {
+    File file;
+    WavSampleFormat format;
+    u32 channels;
+    u64 frames_left;
+    bool failed;
+};
+
+internal void WriteU16(u8** at, u16 value) {
+    (*at)[0] = (u8)value;
+    (*at)[1] = (u8)(value >> 8);
+    *at += 2;
+}
+
+internal void WriteU32(u8** at, u32 value) {
+    WriteU16(at, (u16)value);
+    WriteU16(at, (u16)(value >> 16));
+}
+
+internal void WriteTag(u8** at, const char* tag) {
+    memcpy(*at, tag, 4);
+    *at += 4;
+}
+
+// write_buffer (optional) is handed to FileOpen, see there.
+bool BeginWav(WavWriter* writer, const char* filePath, u64 frame_count, u32 channels, u32 sample_rate, WavSampleFormat format,
+              u8* write_buffer = 0, u32 write_buffer_size = 0) {
+    ZeroStruct(writer);
+    writer->format = format;
+    writer->channels = channels;
+    writer->frames_left = frame_count;
+
+    u32 bytes_per_sample = format == WavSampleFormat_S16 ? 2 : 4;
+    u64 data_size = frame_count * channels * bytes_per_sample;
+    if (data_size > 0xFFFFFFFF - 64) {
+        fprintf(stderr, "%s is too large for a WAV file.\n", filePath);
+        return false;
+    }
+
+    writer->file = FileOpen(filePath, FileMode_Write, write_buffer, write_buffer_size);
+    if (!FileIsOpen(writer->file)) {
+        fprintf(stderr, "Failed to open %s for writing.\n", filePath);
+        return false;
+    }
+
+    // Float data needs the extended fmt chunk and a fact chunk to be valid WAVE.
+    bool is_float = format == WavSampleFormat_F32;
+    u32 fmt_size = is_float ? 18 : 16;
+    u32 fact_size = is_float ? 12 : 0;
+
+    u8 header[64];
+    u8* at = header;
+    WriteTag(&at, "RIFF");
+    WriteU32(&at, (u32)(4 + (8 + fmt_size) + fact_size + 8 + data_size));
+    WriteTag(&at, "WAVE");
+
+    WriteTag(&at, "fmt ");
+    WriteU32(&at, fmt_size);
+    WriteU16(&at, is_float ? 3 : 1); // WAVE_FORMAT_IEEE_FLOAT or WAVE_FORMAT_PCM
+    WriteU16(&at, (u16)channels);
+    WriteU32(&at, sample_rate);
+    WriteU32(&at, sample_rate * channels * bytes_per_sample);
+    WriteU16(&at, (u16)(channels * bytes_per_sample));
+    WriteU16(&at, (u16)(bytes_per_sample * 8));
+    if (is_float) {
+        WriteU16(&at, 0);
+        WriteTag(&at, "fact");
+        WriteU32(&at, 4);
+        WriteU32(&at, (u32)frame_count);
+    }
+
+    WriteTag(&at, "data");
+    WriteU32(&at, (u32)data_size);
+
+    u64 header_size = (u64)(at - header);
+    if (FileWrite(writer->file, header, header_size) != header_size) {
+        writer->failed = true;
+    }
+    return !writer->failed;
+}
+
+// Appends interleaved f32 frames, converting them to the file format.
+bool WriteWavFrames(WavWriter* writer, const float* pcm, u64 frame_count) {
+    if (frame_count > writer->frames_left) {
+        frame_count = writer->frames_left;
+    }
+    writer->frames_left -= frame_count;
+
+    u64 sample_count = frame_count * writer->channels;
+    if (writer->format == WavSampleFormat_F32) {
+        u64 size = sample_count * sizeof(float);
+        writer->failed |= FileWrite(writer->file, (void*)pcm, size) != size;
+        return !writer->failed;
+    }
+
+    s16 converted[4096];
+    for (u64 i = 0; i < sample_count; i += countOf(converted)) {
+        u64 count = sample_count - i < countOf(converted) ? sample_count - i : countOf(converted);
+        for (u64 j = 0; j < count; j++) {
+            float sample = pcm[i + j];
+            sample = sample > 1.0f ? 1.0f : (sample < -1.0f ? -1.0f : sample);
+            converted[j] = (s16)(sample * 32767.0f);
+        }
+        u64 size = count * sizeof(s16);
+        writer->failed |= FileWrite(writer->file, converted, size) != size;
+    }
+    return !writer->failed;
+}
+
+// Pads missing frames with silence so the file always matches its header.
+bool EndWav(WavWriter* writer) {
+    float silence[256] = {};
+    u64 silence_frames = countOf(silence) / writer->channels;
+    while (writer->frames_left > 0 && !writer->failed) {
+        WriteWavFrames(writer, silence, writer->frames_left < silence_frames ? writer->frames_left : silence_frames);
+    }
+
+    bool success = !writer->failed && FileFlush(writer->file);
+    FileClose(writer->file);
+    return success;
+}
+
+#endif // _WAV_WRITER_H_